@@ -3,6 +3,9 @@
 CONFIG   += moc
 CONFIG   += debug_and_release
 
+include(occt.pri)
+include(geometry.pri)
+
 # ---------- Unix / Linux (Qt5 with GCC) ----------
 unix {
     QT += widgets opengl printsupport
@@ -10,39 +13,17 @@ unix {
 
     # GCC specific options
     QMAKE_CXXFLAGS += -Wall -Wextra
-    # --- OCCT 8.0.0 paths ---
-    OCCT_DIR = /usr/local/occt
-
-    INCLUDEPATH += $$OCCT_DIR/include/opencascade
-    LIBS += -L$$OCCT_DIR/lib -Wl,-rpath,$$OCCT_DIR/lib
-
-    # Essential OCCT libraries
-    LIBS += -lTKernel \
-            -lTKMath \
-            -lTKG2d \
-            -lTKG3d \
-            -lTKGeomBase \
-            -lTKBRep \
-            -lTKTopAlgo \
-            -lTKPrim \
-            -lTKV3d \
+
+    # OCCT visualization and modeling libraries on top of occt.pri
+    LIBS += -lTKV3d \
             -lTKOpenGl \
             -lTKService \
-            -lTKLCAF \
-            -lTKCAF \
-            -lTKCDF \
-            -lTKVCAF \
             -lTKMesh \
             -lTKHLR \
             -lTKBO \
             -lTKBool \
             -lTKOffset \
-            -lTKFillet \
-            -lTKXSBase \
-            -lTKXCAF \
-            -lTKBin \
-            -lTKBinL \
-            -lTKBinXCAF
+            -lTKFillet
 
     # Link X11 (required for OpenGL context)
     LIBS += -lX11 -lXext
@@ -75,44 +56,20 @@ win32 {
     LIBS += -lopengl32
     DEFINES += _USE_MATH_DEFINES
     DEFINES += QT_NO_OPENGL_ES_2
-    # --- OCCT 7.8.0 paths ---
-    OCC_INC = D:/Git/OCCT/OCCT-install/inc
-    OCC_LIB = D:/Git/OCCT/OCCT-install/win64/vc14/lib
-    OCC_BIN = D:/Git/OCCT/OCCT-install/win64/vc14/bin
-
-    INCLUDEPATH += $$OCC_INC
-    LIBS += -L$$OCC_LIB
 
     # Add PATH for DLLs during execution
     QMAKE_POST_LINK += $$quote(cmd /C "set PATH=$$OCC_BIN;%PATH% && echo Added OCCT bin to PATH")
 
-    # OCCT core libs (adjusted for 7.8.0)
-    LIBS += -lTKernel \
-            -lTKMath \
-            -lTKG2d \
-            -lTKG3d \
-            -lTKGeomBase \
-            -lTKBRep \
-            -lTKTopAlgo \
-            -lTKPrim \
-            -lTKV3d \
+    # OCCT visualization and modeling libs on top of occt.pri (7.8.0)
+    LIBS += -lTKV3d \
             -lTKOpenGl \
             -lTKService \
-            -lTKLCAF \
-            -lTKCAF \
-            -lTKCDF \
-            -lTKVCAF \
             -lTKMesh \
             -lTKHLR \
             -lTKBO \
             -lTKBool \
             -lTKOffset \
-            -lTKFillet \
-            -lTKXSBase \
-            -lTKXCAF \
-            -lTKBin \
-            -lTKBinL \
-            -lTKBinXCAF
+            -lTKFillet
 
     # ECL paths - ADJUST THESE TO YOUR ECL INSTALLATION
     INCLUDEPATH += D:/Git/ecl/v24.5.10/vc143-x64
@@ -133,14 +90,44 @@ win32 {
 
 SOURCES += \
     src/CadView.cpp \
+    src/DocumentDrivers.cpp \
+    src/DocumentIO.cpp \
+    src/EditJournal.cpp \
+    src/EntityImporter.cpp \
+    src/FeatureGraph.cpp \
+    src/LodShape.cpp \
     src/OcafDocument.cpp \
+    src/PartialFile.cpp \
+    src/Regenerator.cpp \
+    src/ShapeCache.cpp \
+    src/ShapeExporter.cpp \
+    src/SketchFile.cpp \
+    src/SketchGeometryAttribute.cpp \
+    src/SketchPresentation.cpp \
+    src/SnapEngine.cpp \
+    src/Tessellator.cpp \
     src/main.cpp \
     src/MainWindow.cpp
 
 HEADERS += \
     src/CadView.h \
+    src/DocumentDrivers.h \
+    src/DocumentIO.h \
+    src/EditJournal.h \
+    src/EntityImporter.h \
+    src/FeatureGraph.h \
+    src/LodShape.h \
     src/MainWindow.h \
-    src/OcafDocument.h
+    src/OcafDocument.h \
+    src/PartialFile.h \
+    src/Regenerator.h \
+    src/ShapeCache.h \
+    src/ShapeExporter.h \
+    src/SketchFile.h \
+    src/SketchGeometryAttribute.h \
+    src/SketchPresentation.h \
+    src/SnapEngine.h \
+    src/Tessellator.h
 
 RESOURCES += \
     resources.qrc
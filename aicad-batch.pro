@@ -0,0 +1,38 @@
+# aicad-batch.pro - headless batch regeneration of .ocaf documents.
+# Links only the document model and the view-independent shape builder:
+# no Qt widgets, no OpenGL viewer and no X display are required.
+
+TEMPLATE = app
+TARGET   = aicad-batch
+
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+# QtGui is needed for QVector2D/QVector3D only; no QGuiApplication is created
+QT       = core gui
+
+include(occt.pri)
+include(document.pri)
+
+unix {
+    QMAKE_CXXFLAGS += -Wall -Wextra
+}
+
+win32 {
+    DEFINES += _USE_MATH_DEFINES
+}
+
+SOURCES += \
+    src/BatchMain.cpp \
+    src/EntityImporter.cpp \
+    src/Regenerator.cpp \
+    src/ShapeCache.cpp \
+    src/ShapeExporter.cpp \
+    src/SketchFile.cpp
+
+HEADERS += \
+    src/EntityImporter.h \
+    src/Regenerator.h \
+    src/ShapeCache.h \
+    src/ShapeExporter.h \
+    src/SketchFile.h
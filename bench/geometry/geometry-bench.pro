@@ -0,0 +1,23 @@
+# geometry-bench.pro - FeatureBuilder throughput on synthetic extrudes
+
+TEMPLATE = app
+TARGET   = geometry-bench
+
+CONFIG   += console c++17
+CONFIG   -= app_bundle
+
+QT       = core gui
+
+include(../../occt.pri)
+include(../../geometry.pri)
+
+unix {
+    QMAKE_CXXFLAGS += -Wall -Wextra
+}
+
+win32 {
+    DEFINES += _USE_MATH_DEFINES
+}
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,28 @@
+// geometry-bench - FeatureBuilder throughput, serial and on threads.
+//
+//   geometry-bench [shapes] [threads]
+//
+// shapes defaults to 10000, threads to 0 (all cores).
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+
+#include "FeatureBuilder.h"
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+
+    bool ok = true;
+    int shapes = args.size() > 1 ? args.at(1).toInt(&ok) : 10000;
+    bool threadsOk = true;
+    int threads = args.size() > 2 ? args.at(2).toInt(&threadsOk) : 0;
+    if (!ok || !threadsOk || shapes <= 0 || threads < 0) {
+        QTextStream(stderr) << "Usage: geometry-bench [shapes] [threads]\n";
+        return 1;
+    }
+
+    QTextStream(stdout) << FeatureBuilder::benchmark(shapes, threads);
+    return 0;
+}
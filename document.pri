@@ -0,0 +1,22 @@
+# document.pri - the OCAF document model (OcafDocument with its attributes,
+# storage drivers, edit journal and feature graph) on top of geometry.pri.
+# For targets that work on documents without the viewer, such as the tests
+# and benchmarks; include occt.pri first.
+
+include($$PWD/geometry.pri)
+
+SOURCES += \
+    $$PWD/src/DocumentDrivers.cpp \
+    $$PWD/src/EditJournal.cpp \
+    $$PWD/src/FeatureGraph.cpp \
+    $$PWD/src/OcafDocument.cpp \
+    $$PWD/src/PartialFile.cpp \
+    $$PWD/src/SketchGeometryAttribute.cpp
+
+HEADERS += \
+    $$PWD/src/DocumentDrivers.h \
+    $$PWD/src/EditJournal.h \
+    $$PWD/src/FeatureGraph.h \
+    $$PWD/src/OcafDocument.h \
+    $$PWD/src/PartialFile.h \
+    $$PWD/src/SketchGeometryAttribute.h
@@ -0,0 +1,16 @@
+# geometry.pri - view-independent feature geometry (CustomPlane, the
+# packed sketch polylines and FeatureBuilder). Needs only OCCT modeling
+# libraries from occt.pri and QtGui's vector types, so any target can
+# include it without a viewer or the document model.
+
+INCLUDEPATH += $$PWD/src
+
+SOURCES += \
+    $$PWD/src/CustomPlane.cpp \
+    $$PWD/src/FeatureBuilder.cpp \
+    $$PWD/src/SketchPolyline.cpp
+
+HEADERS += \
+    $$PWD/src/CustomPlane.h \
+    $$PWD/src/FeatureBuilder.h \
+    $$PWD/src/SketchPolyline.h
@@ -0,0 +1,42 @@
+# occt.pri - OpenCASCADE paths and the modeling, OCAF and STEP/IGES libraries
+# shared by AICAD.pro and aicad-batch.pro. Visualization libraries are added by the
+# GUI project only.
+
+unix {
+    # --- OCCT 8.0.0 paths ---
+    OCCT_DIR = /usr/local/occt
+
+    INCLUDEPATH += $$OCCT_DIR/include/opencascade
+    LIBS += -L$$OCCT_DIR/lib -Wl,-rpath,$$OCCT_DIR/lib
+}
+
+win32 {
+    # --- OCCT 7.8.0 paths ---
+    OCC_INC = D:/Git/OCCT/OCCT-install/inc
+    OCC_LIB = D:/Git/OCCT/OCCT-install/win64/vc14/lib
+    OCC_BIN = D:/Git/OCCT/OCCT-install/win64/vc14/bin
+
+    INCLUDEPATH += $$OCC_INC
+    LIBS += -L$$OCC_LIB
+}
+
+LIBS += -lTKernel \
+        -lTKMath \
+        -lTKG2d \
+        -lTKG3d \
+        -lTKGeomBase \
+        -lTKBRep \
+        -lTKTopAlgo \
+        -lTKPrim \
+        -lTKLCAF \
+        -lTKCAF \
+        -lTKCDF \
+        -lTKVCAF \
+        -lTKXSBase \
+        -lTKXCAF \
+        -lTKDE \
+        -lTKDESTEP \
+        -lTKDEIGES \
+        -lTKBin \
+        -lTKBinL \
+        -lTKBinXCAF
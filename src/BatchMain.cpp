@@ -0,0 +1,327 @@
+// aicad-batch - regenerate .ocaf documents without a display.
+//
+// Exit codes are meant for scripts driving large overnight runs:
+//   0  every document regenerated and written
+//   1  bad command line
+//   2  at least one document could not be opened
+//   3  at least one feature failed to regenerate
+//   4  at least one output file could not be written
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+
+#include "EntityImporter.h"
+#include "FeatureBuilder.h"
+#include "OcafDocument.h"
+#include "Regenerator.h"
+#include "ShapeExporter.h"
+#include "SketchFile.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    // Heap allocations made through operator new, for --count-allocations.
+    // OCCT objects come from Standard::Allocate and are not included, so
+    // the count covers the Qt containers that carry feature data around.
+    // Off unless the option is given, so other runs pay one relaxed load
+    // per allocation rather than two contended increments.
+    std::atomic<bool> g_countAllocations(false);
+    std::atomic<qint64> g_allocations(0);
+    std::atomic<qint64> g_allocatedBytes(0);
+
+    enum ExitCode {
+        ExitOk = 0,
+        ExitUsage = 1,
+        ExitOpenFailed = 2,
+        ExitRegenFailed = 3,
+        ExitWriteFailed = 4
+    };
+
+    QString featureTypeName(FeatureType type) {
+        switch (type) {
+        case FeatureType::Sketch: return "Sketch";
+        case FeatureType::Extrude: return "Extrude";
+        default: return "Unknown";
+        }
+    }
+
+    // Report fields are separated by commas; keep names from breaking columns
+    QString csvField(QString value) {
+        if (value.contains(',') || value.contains('"')) {
+            value.replace("\"", "\"\"");
+            return "\"" + value + "\"";
+        }
+        return value;
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (g_countAllocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(qint64(size), std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("aicad-batch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Regenerate every feature of AICAD .ocaf documents.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("documents", "Documents to regenerate.", "<file.ocaf>...");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+        "Write each document's shapes to <dir>/<name>.<format>.", "dir");
+    QCommandLineOption formatOption("format",
+        "Shape file format for --output: step, iges or brep.", "format", "brep");
+    QCommandLineOption reportOption(QStringList() << "r" << "report",
+        "Write a per-feature timing report (CSV) to <file>, '-' for stdout.", "file");
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads",
+        "Build with <n> threads (0 = all cores).", "n", "0");
+    QCommandLineOption cacheOption("cache",
+        "Reuse and store built shapes in <dir>.", "dir");
+    QCommandLineOption saveOption("save",
+        "Write the regenerated document back to its file.");
+    QCommandLineOption allocationsOption("count-allocations",
+        "Report the heap allocations made by each document's regeneration.");
+    QCommandLineOption benchGeometryOption("bench-geometry",
+        "Measure FeatureBuilder throughput on <n> synthetic extrudes and exit.", "n");
+    QCommandLineOption convertOption("convert",
+        "Convert legacy .cad and LINE/ARC text files to .aisk sketch files next to them and exit.");
+    QCommandLineOption benchSketchOption("bench-sketch-io",
+        "Compare reading <n> LINE/ARC entities from text and from a .aisk file and exit.", "n");
+    QCommandLineOption benchImportOption("bench-import",
+        "Compare the QTextStream reader with the streaming importer on <n> LINE/ARC entities and exit.", "n");
+    QCommandLineOption benchExportOption("bench-export",
+        "Time STEP, IGES and BREP export of <n> synthetic parts and exit.", "n");
+
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(reportOption);
+    parser.addOption(threadsOption);
+    parser.addOption(cacheOption);
+    parser.addOption(saveOption);
+    parser.addOption(allocationsOption);
+    parser.addOption(benchGeometryOption);
+    parser.addOption(convertOption);
+    parser.addOption(benchSketchOption);
+    parser.addOption(benchImportOption);
+    parser.addOption(benchExportOption);
+    parser.process(app);
+
+    const QStringList documents = parser.positionalArguments();
+    bool threadsOk = false;
+    int threads = parser.value(threadsOption).toInt(&threadsOk);
+
+    if (parser.isSet(benchGeometryOption)) {
+        int shapes = parser.value(benchGeometryOption).toInt();
+        if (shapes <= 0 || !threadsOk || threads < 0) {
+            QTextStream(stderr) << parser.helpText();
+            return ExitUsage;
+        }
+        QTextStream(stdout) << FeatureBuilder::benchmark(shapes, threads);
+        return ExitOk;
+    }
+
+    if (parser.isSet(benchSketchOption)) {
+        int entities = parser.value(benchSketchOption).toInt();
+        if (entities <= 0) {
+            QTextStream(stderr) << parser.helpText();
+            return ExitUsage;
+        }
+        QTextStream(stdout) << SketchFile::benchmark(entities);
+        return ExitOk;
+    }
+
+    if (parser.isSet(benchImportOption)) {
+        int entities = parser.value(benchImportOption).toInt();
+        if (entities <= 0) {
+            QTextStream(stderr) << parser.helpText();
+            return ExitUsage;
+        }
+        QTextStream(stdout) << EntityImporter::benchmark(entities);
+        return ExitOk;
+    }
+
+    if (parser.isSet(benchExportOption)) {
+        int parts = parser.value(benchExportOption).toInt();
+        if (parts <= 0) {
+            QTextStream(stderr) << parser.helpText();
+            return ExitUsage;
+        }
+        QTextStream(stdout) << ShapeExporter::benchmark(parts);
+        return ExitOk;
+    }
+
+    if (parser.isSet(convertOption)) {
+        if (documents.isEmpty()) {
+            QTextStream(stderr) << parser.helpText();
+            return ExitUsage;
+        }
+
+        int exitCode = ExitOk;
+        for (const QString& path : documents) {
+            SketchFile::Contents contents;
+            QString error;
+            if (!SketchFile::readLegacyText(path, contents, &error)) {
+                QTextStream(stderr) << path << ": " << error << "\n";
+                exitCode = qMax(exitCode, int(ExitOpenFailed));
+                continue;
+            }
+
+            QFileInfo info(path);
+            QString target = info.dir().filePath(info.completeBaseName() + ".aisk");
+            if (!SketchFile::write(target, contents, &error)) {
+                QTextStream(stderr) << target << ": " << error << "\n";
+                exitCode = qMax(exitCode, int(ExitWriteFailed));
+                continue;
+            }
+            QTextStream(stderr) << path << ": " << contents.sketches.size() << " sketch(es), "
+                                << contents.extrudes.size() << " extrude(s) written to " << target << "\n";
+        }
+        return exitCode;
+    }
+
+    if (documents.isEmpty() || !threadsOk || threads < 0) {
+        QTextStream(stderr) << parser.helpText();
+        return ExitUsage;
+    }
+
+    QString outputSuffix = parser.value(formatOption).toLower();
+    ShapeExporter::Format outputFormat;
+    if (!ShapeExporter::formatForPath("shapes." + outputSuffix, outputFormat)) {
+        QTextStream(stderr) << "Unknown shape format " << outputSuffix << "\n";
+        return ExitUsage;
+    }
+
+    QString outputDir = parser.value(outputOption);
+    if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) {
+        QTextStream(stderr) << "Cannot create output directory " << outputDir << "\n";
+        return ExitUsage;
+    }
+
+    QFile reportFile;
+    if (parser.isSet(reportOption)) {
+        QString reportPath = parser.value(reportOption);
+        bool opened = false;
+        if (reportPath == "-") {
+            opened = reportFile.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+        } else {
+            reportFile.setFileName(reportPath);
+            opened = reportFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate);
+        }
+        if (!opened) {
+            QTextStream(stderr) << "Cannot open report file " << reportPath << "\n";
+            return ExitUsage;
+        }
+    }
+    QTextStream report(&reportFile);
+    if (reportFile.isOpen()) {
+        report << "document,feature_id,name,type,status,cached,ms\n";
+    }
+
+    OcafDocument document;
+    Regenerator regenerator;
+    regenerator.setDocument(&document);
+    regenerator.setThreadCount(threads);
+    ShapeExporter exporter;
+    exporter.setThreadCount(threads);
+    if (parser.isSet(cacheOption)) {
+        regenerator.cache().setDiskDirectory(parser.value(cacheOption));
+    }
+
+    bool countAllocations = parser.isSet(allocationsOption);
+    g_countAllocations.store(countAllocations, std::memory_order_relaxed);
+
+    int exitCode = ExitOk;
+    auto fail = [&exitCode](int code) {
+        if (code > exitCode) exitCode = code;
+    };
+
+    for (const QString& path : documents) {
+        QElapsedTimer timer;
+        timer.start();
+
+        if (!document.loadDocument(path)) {
+            QTextStream(stderr) << path << ": cannot open document\n";
+            fail(ExitOpenFailed);
+            continue;
+        }
+
+        qint64 allocationsBefore = g_allocations.load();
+        qint64 bytesBefore = g_allocatedBytes.load();
+        regenerator.regenerate();
+
+        if (countAllocations) {
+            qint64 allocations = g_allocations.load() - allocationsBefore;
+            qint64 allocatedBytes = g_allocatedBytes.load() - bytesBefore;
+            int features = regenerator.lastTimings().size();
+            QTextStream(stderr) << path << ": " << allocations << " allocations ("
+                                << allocatedBytes << " bytes) in regeneration, "
+                                << (features > 0 ? allocations / features : 0) << " per extrude\n";
+        }
+
+        int failed = 0;
+        for (const Regenerator::FeatureTiming& timing : regenerator.lastTimings()) {
+            if (!timing.ok) ++failed;
+            if (!reportFile.isOpen()) continue;
+
+            TDF_Label label = document.findFeature(timing.featureId);
+            report << csvField(path) << ','
+                   << timing.featureId << ','
+                   << csvField(document.getFeatureName(label)) << ','
+                   << featureTypeName(document.getFeatureType(label)) << ','
+                   << (timing.ok ? "ok" : "failed") << ','
+                   << (timing.cached ? 1 : 0) << ','
+                   << QString::number(timing.milliseconds, 'f', 3) << '\n';
+        }
+        if (failed > 0) {
+            QTextStream(stderr) << path << ": " << failed << " feature(s) failed to regenerate\n";
+            fail(ExitRegenFailed);
+        }
+
+        if (!outputDir.isEmpty()) {
+            QString baseName = QFileInfo(path).completeBaseName();
+            QString shapePath = QDir(outputDir).filePath(baseName + "." + outputSuffix);
+            ShapeExporter::Result exported = exporter.write(document, shapePath, outputFormat, baseName);
+            if (!exported.ok) {
+                QTextStream(stderr) << shapePath << ": cannot write shapes\n";
+                fail(ExitWriteFailed);
+            }
+        }
+
+        if (parser.isSet(saveOption) && !document.saveDocument(path)) {
+            QTextStream(stderr) << path << ": cannot save document\n";
+            fail(ExitWriteFailed);
+        }
+
+        // Progress goes to stderr so a report on stdout stays machine-readable
+        QTextStream(stderr) << path << ": " << regenerator.lastTimings().size()
+                            << " shapes regenerated in " << timer.elapsed() << " ms\n";
+    }
+
+    report.flush();
+    return exitCode;
+}
@@ -1,14 +1,14 @@
 #include "CadView.h"
+#include "LodShape.h"
+#include "SketchPresentation.h"
+#include "Tessellator.h"
 
-#include <BRepBuilderAPI_MakeEdge.hxx>
-#include <BRepBuilderAPI_MakeWire.hxx>
-#include <BRepBuilderAPI_MakeFace.hxx>
-#include <BRepPrimAPI_MakePrism.hxx>
 #include <GC_MakeSegment.hxx>
+#include <Graphic3d_AttribBuffer.hxx>
+#include <Graphic3d_ZLayerSettings.hxx>
 #include <Geom_TrimmedCurve.hxx>
 #include <gp_Pnt.hxx>
 #include <gp_Vec.hxx>
-#include <IntAna_IntConicQuad.hxx>
 
 #include <Quantity_Color.hxx>
 #include <Aspect_Window.hxx>
@@ -22,7 +22,14 @@
 #endif
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QGuiApplication>
 #include <QPainter>
+#include <QScreen>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
 
 namespace {
     // Helper to get proper OCCT coordinates from Qt event
@@ -43,8 +50,22 @@ namespace {
 
 CadView::CadView(QWidget* parent)
     : QWidget(parent)
-    , m_rubberBandObject(nullptr)
+    , m_shownRubberBand(nullptr)
+    , m_overlayLayer(Graphic3d_ZLayerId_Top)
+    , m_frameTimer(new QTimer(this))
+    , m_lastFrameNs(0)
+    , m_frameIntervalNs(16666667)
     , m_document(nullptr)
+    , m_updateDepth(0)
+    , m_pendingDisplayAll(false)
+    , m_displayTimer(new QTimer(this))
+    , m_displayFitted(false)
+    , m_tessellator(new Tessellator(this))
+    , m_displayGeneration(0)
+    , m_meshGeneration(0)
+    , m_meshFit(false)
+    , m_highlightedFeature(-1)
+    , m_snapTypes(SnapEngine::AllSnaps)
     , m_currentView(SketchView::Isometric)
     , m_mode(CadMode::Idle)
     , m_rubberBandMode(RubberBandMode::None)
@@ -58,11 +79,33 @@ CadView::CadView(QWidget* parent)
     setMouseTracking(true);
     setBackgroundRole(QPalette::NoRole);
 
+    resetFrameStats();
+    resetLatencyStats();
+    resetPendingInput();
+    m_lastSnap.type = SnapEngine::None;
+
+    // Pace input-driven frames to the display refresh rate
+    if (QScreen* screen = QGuiApplication::primaryScreen()) {
+        if (screen->refreshRate() > 1.0) {
+            m_frameIntervalNs = qint64(1.0e9 / screen->refreshRate());
+        }
+    }
+    m_clock.start();
+    m_frameTimer->setSingleShot(true);
+    m_frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_frameTimer, &QTimer::timeout, this, &CadView::renderFrame);
+
+    m_displayTimer->setInterval(0);
+    connect(m_displayTimer, &QTimer::timeout, this, &CadView::displayNextChunk);
+    connect(m_tessellator, &Tessellator::finished, this, &CadView::onFeaturesMeshed);
+    connect(m_tessellator, &Tessellator::levelsMeshed, this, &CadView::onLevelsMeshed);
+
     initializeViewer();
 }
 
 CadView::~CadView() {
     clearRubberBand();
+    clearCrosshair();
     clearGrid();
 }
 
@@ -107,6 +150,26 @@ void CadView::initializeViewer() {
     m_context = new AIS_InteractiveContext(m_viewer);
     m_context->SetDisplayMode(AIS_Shaded, Standard_True);
 
+    // Transient overlays (hover highlight, rubber band, crosshair, snap
+    // markers) get their own immediate layer: changing them only needs
+    // RedrawImmediate over the cached scene, never a full Redraw
+    Graphic3d_ZLayerSettings overlaySettings;
+    overlaySettings.SetName("Overlays");
+    overlaySettings.SetImmediate(Standard_True);
+    overlaySettings.SetEnableDepthWrite(Standard_False);
+    overlaySettings.SetClearDepth(Standard_False);
+    if (!m_viewer->AddZLayer(m_overlayLayer, overlaySettings)) {
+        m_overlayLayer = Graphic3d_ZLayerId_Top;
+    }
+    m_context->HighlightStyle(Prs3d_TypeOfHighlight_Dynamic)->SetZLayer(m_overlayLayer);
+    m_context->HighlightStyle(Prs3d_TypeOfHighlight_LocalDynamic)->SetZLayer(m_overlayLayer);
+
+    initOverlay(m_lineBand, Quantity_NOC_WHITE, Aspect_TOL_DASH, 2.0, false);
+    initOverlay(m_rectangleBand, Quantity_NOC_WHITE, Aspect_TOL_DASH, 2.0, false);
+    initOverlay(m_polylineBand, Quantity_NOC_WHITE, Aspect_TOL_DASH, 2.0, false);
+    initOverlay(m_crosshair, Quantity_NOC_GRAY40, Aspect_TOL_SOLID, 1.0, true);
+    initOverlay(m_snapMarker, Quantity_NOC_YELLOW, Aspect_TOL_SOLID, 2.0, true);
+
     m_viewCube = new AIS_ViewCube();
     m_viewCube->SetBoxColor(Quantity_NOC_GRAY75);
     m_viewCube->SetSize(55);
@@ -122,18 +185,21 @@ void CadView::initializeViewer() {
     QTimer::singleShot(0, this, [this]() {
         if (!m_view.IsNull()) {
             m_view->MustBeResized();
-            m_view->Redraw();
+            redrawScene();
         }
     });
 }
 
 void CadView::setDocument(OcafDocument* doc) {
     m_document = doc;
+    cacheActivePlane();
+    m_regenerator.setDocument(doc);
     displayAllFeatures();
 }
 
 void CadView::setSketchView(SketchView view) {
     m_currentView = view;
+    cacheActivePlane();
 
     switch(view) {
     case SketchView::Top:
@@ -174,48 +240,360 @@ void CadView::fitAll() {
 
 void CadView::refreshView() {
     if (!m_view.IsNull()) {
-        m_view->Redraw();
+        redrawScene();
         update();
     }
 }
 
+void CadView::redrawScene() {
+    QElapsedTimer timer;
+    timer.start();
+    updateLevelsOfDetail();
+    updateGrid();
+    m_view->Redraw();
+    double ms = timer.nsecsElapsed() / 1.0e6;
+
+    ++m_frameStats.sceneFrames;
+    m_frameStats.sceneMs += ms;
+    m_frameStats.sceneMaxMs = qMax(m_frameStats.sceneMaxMs, ms);
+}
+
+void CadView::redrawOverlays() {
+    QElapsedTimer timer;
+    timer.start();
+    m_view->RedrawImmediate();
+    double ms = timer.nsecsElapsed() / 1.0e6;
+
+    ++m_frameStats.overlayFrames;
+    m_frameStats.overlayMs += ms;
+    m_frameStats.overlayMaxMs = qMax(m_frameStats.overlayMaxMs, ms);
+}
+
+void CadView::resetFrameStats() {
+    m_frameStats.sceneFrames = 0;
+    m_frameStats.sceneMs = 0.0;
+    m_frameStats.sceneMaxMs = 0.0;
+    m_frameStats.overlayFrames = 0;
+    m_frameStats.overlayMs = 0.0;
+    m_frameStats.overlayMaxMs = 0.0;
+}
+
+QString CadView::frameStatsReport() const {
+    const FrameStats& st = m_frameStats;
+    return QString("scene redraws:   %1, avg %2 ms, max %3 ms\n"
+                   "overlay redraws: %4, avg %5 ms, max %6 ms\n")
+        .arg(st.sceneFrames)
+        .arg(st.sceneFrames > 0 ? st.sceneMs / st.sceneFrames : 0.0, 0, 'f', 2)
+        .arg(st.sceneMaxMs, 0, 'f', 2)
+        .arg(st.overlayFrames)
+        .arg(st.overlayFrames > 0 ? st.overlayMs / st.overlayFrames : 0.0, 0, 'f', 2)
+        .arg(st.overlayMaxMs, 0, 'f', 2);
+}
+
+// Latency histogram bucket upper bounds in ms; the last bucket is open
+static const double kLatencyBucketMs[] = { 1, 2, 4, 8, 16, 33, 50, 100 };
+static const int kLatencyBucketCount = int(sizeof(kLatencyBucketMs) / sizeof(kLatencyBucketMs[0])) + 1;
+
+void CadView::resetLatencyStats() {
+    m_latencyBuckets = QVector<int>(kLatencyBucketCount, 0);
+    m_latencyCount = 0;
+    m_latencySumMs = 0.0;
+    m_latencyMaxMs = 0.0;
+}
+
+QString CadView::latencyReport() const {
+    QString report = QString("input-to-frame latency: %1 frames, avg %2 ms, max %3 ms\n")
+        .arg(m_latencyCount)
+        .arg(m_latencyCount > 0 ? m_latencySumMs / m_latencyCount : 0.0, 0, 'f', 2)
+        .arg(m_latencyMaxMs, 0, 'f', 2);
+    for (int i = 0; i < kLatencyBucketCount; ++i) {
+        QString label = i < kLatencyBucketCount - 1
+            ? QString("< %1 ms").arg(kLatencyBucketMs[i])
+            : QString(">= %1 ms").arg(kLatencyBucketMs[i - 1]);
+        report += QString("  %1 %2\n").arg(label, -10).arg(m_latencyBuckets[i]);
+    }
+    return report;
+}
+
+void CadView::resetPendingInput() {
+    m_pending.any = false;
+    m_pending.moved = false;
+    m_pending.pos = QPoint();
+    m_pending.panDx = 0;
+    m_pending.panDy = 0;
+    m_pending.rotate = false;
+    m_pending.zoomFactor = 1.0;
+    m_pending.firstEventNs = 0;
+}
+
+void CadView::scheduleFrame() {
+    qint64 now = m_clock.nsecsElapsed();
+    if (!m_pending.any) {
+        m_pending.any = true;
+        m_pending.firstEventNs = now;
+    }
+    if (m_frameTimer->isActive()) return;
+
+    // Render right away if a frame interval has already passed since the
+    // last one, otherwise wait for the next tick
+    qint64 wait = m_lastFrameNs + m_frameIntervalNs - now;
+    m_frameTimer->start(wait > 0 ? int(wait / 1000000) : 0);
+}
+
+void CadView::flushInput() {
+    if (m_frameTimer->isActive()) {
+        m_frameTimer->stop();
+        renderFrame();
+    }
+}
+
+void CadView::renderFrame() {
+    if (!m_pending.any) return;
+    PendingInput input = m_pending;
+    resetPendingInput();
+    if (m_view.IsNull() || m_context.IsNull()) return;
+
+    bool viewChanged = false;
+    if (input.panDx != 0 || input.panDy != 0) {
+        m_view->Pan(input.panDx, -input.panDy);
+        viewChanged = true;
+    }
+    if (input.rotate) {
+        Standard_Integer xp, yp;
+        QtToOCCT(this, input.pos, xp, yp);
+        m_view->Rotation(xp, yp);
+        viewChanged = true;
+    }
+    if (input.zoomFactor != 1.0) {
+        m_view->SetScale(m_view->Scale() * input.zoomFactor);
+        viewChanged = true;
+    }
+
+    if (input.moved) {
+        Standard_Integer xp, yp;
+        QtToOCCT(this, input.pos, xp, yp);
+
+        // Update OCCT hover detection. The hover highlight is drawn in the
+        // overlay layer, so it is shown by the immediate redraw below
+        m_context->MoveTo(xp, yp, m_view, Standard_False);
+        Handle(AIS_InteractiveObject) detected;
+        if (m_context->HasDetected()) {
+            detected = m_context->DetectedInteractive();
+        }
+        if (!detected.IsNull() && detected == m_viewCube) {
+            setCursor(Qt::PointingHandCursor);
+        } else {
+            unsetCursor();
+        }
+
+        if (m_mode == CadMode::Sketching || m_mode == CadMode::GetPoint) {
+            m_currentPoint = snapToGeometry(screenToPlane(input.pos));
+            updateSnapMarker();
+            m_hasCurrentPoint = true;
+            updateCrosshair();
+            updateRubberBand();
+        }
+    }
+
+    if (viewChanged) {
+        redrawScene();
+    } else {
+        redrawOverlays();
+    }
+
+    m_lastFrameNs = m_clock.nsecsElapsed();
+    double ms = (m_lastFrameNs - input.firstEventNs) / 1.0e6;
+    int bucket = 0;
+    while (bucket < kLatencyBucketCount - 1 && ms >= kLatencyBucketMs[bucket]) {
+        ++bucket;
+    }
+    ++m_latencyBuckets[bucket];
+    ++m_latencyCount;
+    m_latencySumMs += ms;
+    m_latencyMaxMs = qMax(m_latencyMaxMs, ms);
+}
+
 void CadView::displayAllFeatures() {
     if (!m_document) return;
 
-    m_context->RemoveAll(Standard_False);
-    m_context->Display(m_viewCube, Standard_False);
+    if (m_updateDepth > 0) {
+        m_pendingDisplayAll = true;
+        return;
+    }
+
+    m_displayTimer->stop();
+    m_displayQueue.clear();
 
+    // A running mesh job belongs to an older state; onFeaturesMeshed
+    // notices and comes back here
+    ++m_displayGeneration;
+    if (m_tessellator->isRunning()) return;
+
+    if (m_document->hasUnloadedFeatures()) {
+        // A freshly opened document; nothing on screen belongs to it
+        clearFeatureObjects();
+        m_featureColors.clear();
+        m_highlightedFeature = -1;
+        m_context->UpdateCurrentViewer();
+
+        m_displayQueue = m_document->getFeatures();
+        m_displayFitted = false;
+        m_displayTimer->start();
+        return;
+    }
+
+    // Only edited features and their dependents are rebuilt; everything
+    // else is redisplayed from the shape stored in the document
+    m_regenerator.regenerate();
+
+    // Drop objects of features that no longer exist (undo, reload);
+    // presentFeature replaces the rest one by one
     QVector<TDF_Label> features = m_document->getFeatures();
+    QSet<int> ids;
     for (const TDF_Label& label : features) {
-        displayFeature(label);
+        ids.insert(m_document->getFeatureId(label));
+    }
+    for (int featureId : m_featureObjects.keys()) {
+        if (!ids.contains(featureId)) {
+            removeFeatureObject(featureId);
+            m_featureColors.remove(featureId);
+        }
     }
 
-    fitAll();
+    presentWhenMeshed(features, true);
+}
+
+QVector<TopoDS_Shape> CadView::extrudeShapes(const QVector<TDF_Label>& labels) const {
+    QVector<TopoDS_Shape> shapes;
+    for (const TDF_Label& label : labels) {
+        if (m_document->getFeatureType(label) != FeatureType::Extrude) continue;
+        TopoDS_Shape shape = m_document->getShape(label);
+        if (!shape.IsNull()) shapes.append(shape);
+    }
+    return shapes;
+}
+
+void CadView::presentWhenMeshed(const QVector<TDF_Label>& labels, bool fit) {
+    m_meshLabels = labels;
+    m_meshFit = fit;
+    m_meshGeneration = m_displayGeneration;
+    m_tessellator->start(extrudeShapes(labels));
+}
+
+void CadView::onFeaturesMeshed() {
+    QVector<TDF_Label> labels;
+    labels.swap(m_meshLabels);
+    if (!m_document) return;
+
+    if (m_meshGeneration != m_displayGeneration) {
+        displayAllFeatures();
+        return;
+    }
+
+    for (const TDF_Label& label : labels) {
+        presentFeature(label);
+    }
+    m_context->UpdateCurrentViewer();
+    if (m_meshFit) fitAll();
+
+    if (!m_displayQueue.isEmpty()) m_displayTimer->start();
+    startLevelMeshing();
 }
 
 void CadView::displayFeature(TDF_Label label) {
     if (label.IsNull() || !m_document) return;
 
+    if (m_updateDepth > 0) {
+        if (!m_pendingDisplay.contains(label)) m_pendingDisplay.append(label);
+        return;
+    }
+
+    m_displayQueue.removeAll(label);
+    m_document->materialize(QVector<TDF_Label>() << label);
+    m_regenerator.regenerateFeature(label);
+    waitForMeshing();
+    Tessellator::meshShapes(extrudeShapes(QVector<TDF_Label>() << label));
+    presentFeature(label);
+    m_context->UpdateCurrentViewer();
+}
+
+void CadView::waitForMeshing() {
+    m_tessellator->wait();
+}
+
+void CadView::beginUpdate() {
+    ++m_updateDepth;
+}
+
+void CadView::endUpdate() {
+    if (m_updateDepth == 0 || --m_updateDepth > 0) return;
+
+    QVector<TDF_Label> pending;
+    pending.swap(m_pendingDisplay);
+
+    if (m_pendingDisplayAll) {
+        m_pendingDisplayAll = false;
+        displayAllFeatures();
+        return;
+    }
+    if (pending.isEmpty() || !m_document) return;
+
+    for (const TDF_Label& label : pending) m_displayQueue.removeAll(label);
+    m_document->materialize(pending);
+
+    // One regeneration for the whole batch, so independent features
+    // still build in parallel
+    m_regenerator.regenerate();
+    waitForMeshing();
+    Tessellator::meshShapes(extrudeShapes(pending));
+    for (const TDF_Label& label : pending) {
+        presentFeature(label);
+    }
+    m_context->UpdateCurrentViewer();
+}
+
+void CadView::displayNextChunk() {
+    // Enough features per tick to amortize one pass over the file, few
+    // enough to keep the event loop responsive
+    const int chunkSize = 64;
+
+    // The timer is restarted once the chunk is meshed and shown
+    m_displayTimer->stop();
+    if (!m_document || m_displayQueue.isEmpty() || m_tessellator->isRunning()) {
+        return;
+    }
+
+    QVector<TDF_Label> chunk = m_displayQueue.mid(0, chunkSize);
+    m_displayQueue.remove(0, chunk.size());
+
+    m_document->materialize(chunk);
+    for (const TDF_Label& label : chunk) {
+        m_regenerator.regenerateFeature(label);
+    }
+
+    // Frame the first chunk right away and everything once it is all in
+    bool fit = !m_displayFitted || m_displayQueue.isEmpty();
+    m_displayFitted = true;
+    presentWhenMeshed(chunk, fit);
+}
+
+void CadView::presentFeature(TDF_Label label) {
     FeatureType type = m_document->getFeatureType(label);
+    int featureId = m_document->getFeatureId(label);
     TopoDS_Shape shape;
+    Handle(AIS_InteractiveObject) object;
 
-    if (type == FeatureType::Sketch) {
-        QVector<QVector<QVector2D>> polylines = m_document->getSketchPolylines(label);
-        CustomPlane plane = m_document->getSketchPlane(label);
+    removeFeatureObject(featureId);
 
-        for (const auto& points : polylines) {
-            if (!points.isEmpty()) {
-                shape = createPolylineShape(points, plane);
-
-                Handle(AIS_Shape) aisShape = new AIS_Shape(shape);
-                aisShape->SetColor(Quantity_NOC_WHITE);
-                aisShape->SetWidth(2.0);
-                m_context->Display(aisShape, Standard_False);
-            }
-        }
+    if (type == FeatureType::Sketch) {
+        Handle(SketchPresentation) sketch = new SketchPresentation(
+            m_document->getSketchPolylines(label), m_document->getSketchPlane(label));
+        sketch->SetColor(m_featureColors.value(featureId, Quantity_NOC_WHITE));
+        sketch->SetWidth(2.0);
+        m_context->Display(sketch, 0, SketchPresentation::SelectWhole, Standard_False);
+        object = sketch;
     } else if (type == FeatureType::Extrude) {
         TDF_Label sketchLabel = m_document->getExtrudeSketch(label);
-        double height = m_document->getExtrudeHeight(label);
 
         if (sketchLabel.IsNull()) {
             qWarning() << "Extrude feature" << m_document->getFeatureId(label)
@@ -223,42 +601,160 @@ void CadView::displayFeature(TDF_Label label) {
             return;
         }
 
-        shape = createExtrudeShape(sketchLabel, height);
+        shape = m_document->getShape(label);
 
         if (!shape.IsNull()) {
-            m_document->setShape(label, shape);
-
-            Handle(AIS_Shape) aisShape = new AIS_Shape(shape);
-            aisShape->SetColor(Quantity_NOC_LIGHTSTEELBLUE);
-            m_context->Display(aisShape, Standard_False);
+            Handle(LodShape) aisShape = new LodShape(shape);
+            aisShape->SetColor(m_featureColors.value(featureId, Quantity_NOC_LIGHTSTEELBLUE));
+            int level = aisShape->levelForScreenSize(projectedSize(aisShape->bounds()));
+            requestLevel(aisShape, level);
+            level = aisShape->nearestMeshedLevel(level);
+            m_context->Display(aisShape, LodShape::displayModeForLevel(level), 0, Standard_False);
+            object = aisShape;
         } else {
             qWarning() << "Failed to create extrude shape for feature"
                        << m_document->getFeatureId(label);
         }
     }
 
-    m_context->UpdateCurrentViewer();
+    if (label == m_pendingSketch) syncSnapEngine();
+
+    if (object.IsNull()) return;
+    m_featureObjects.insert(featureId, object);
+    if (featureId == m_highlightedFeature) {
+        m_context->AddOrRemoveSelected(object, Standard_False);
+    }
 }
 
-void CadView::updateRubberBand() {
-    if (m_context.IsNull()) return;
+void CadView::removeFeatureObject(int featureId) {
+    Handle(AIS_InteractiveObject) object = m_featureObjects.take(featureId);
+    if (!object.IsNull()) {
+        m_context->Remove(object, Standard_False);
+    }
+}
 
-    // Clear previous rubber band
-    clearRubberBand();
+void CadView::clearFeatureObjects() {
+    for (const Handle(AIS_InteractiveObject)& object : m_featureObjects) {
+        m_context->Remove(object, Standard_False);
+    }
+    m_featureObjects.clear();
+}
+
+bool CadView::isNavigating() const {
+    return m_mousePressed && m_mode != CadMode::Sketching
+        && (m_pressedButton == Qt::MiddleButton || m_pressedButton == Qt::RightButton);
+}
 
-    if (m_mode != CadMode::Sketching) return;
-    if (m_sketchPoints.isEmpty() || !m_hasCurrentPoint) return;
+double CadView::projectedSize(const Bnd_Box& box) const {
+    if (box.IsVoid() || m_view.IsNull()) return 0.0;
+
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    const double xs[2] = { xmin, xmax };
+    const double ys[2] = { ymin, ymax };
+    const double zs[2] = { zmin, zmax };
+
+    int left = 0, right = 0, top = 0, bottom = 0;
+    for (int i = 0; i < 8; ++i) {
+        Standard_Integer xp, yp;
+        m_view->Convert(xs[i & 1], ys[(i >> 1) & 1], zs[i >> 2], xp, yp);
+        if (i == 0 || xp < left) left = xp;
+        if (i == 0 || xp > right) right = xp;
+        if (i == 0 || yp < top) top = yp;
+        if (i == 0 || yp > bottom) bottom = yp;
+    }
+    return std::sqrt(double(right - left) * (right - left) + double(bottom - top) * (bottom - top));
+}
+
+bool CadView::updateLevelsOfDetail() {
+    if (m_context.IsNull()) return false;
+
+    bool changed = false;
+    bool navigating = isNavigating();
+    for (const Handle(AIS_InteractiveObject)& object : m_featureObjects) {
+        Handle(LodShape) lod = Handle(LodShape)::DownCast(object);
+        if (lod.IsNull() || !m_context->IsDisplayed(lod)) continue;
+
+        int level = lod->levelForScreenSize(projectedSize(lod->bounds()));
+        if (navigating) level = qMin(level + 1, LodShape::LevelCount - 1);
+        if (!lod->hasLevel(level)) {
+            requestLevel(lod, level);
+            // A finer level on screen stays; a coarser one moves as close
+            // as the meshed levels allow
+            int shown = LodShape::levelForDisplayMode(lod->DisplayMode());
+            level = lod->hasLevel(shown) && shown < level ? shown : lod->nearestMeshedLevel(level);
+        }
+
+        int mode = LodShape::displayModeForLevel(level);
+        if (lod->DisplayMode() != mode) {
+            m_context->SetDisplayMode(lod, mode, Standard_False);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void CadView::requestLevel(const Handle(LodShape)& lod, int level) {
+    if (!lod->requestLevel(level)) return;
+    LevelRequest request;
+    request.shape = lod;
+    request.level = level;
+    m_levelRequests.append(request);
+    startLevelMeshing();
+}
 
-    // Get the sketch plane
+void CadView::startLevelMeshing() {
+    if (m_levelRequests.isEmpty() || m_tessellator->isRunning() || !m_displayQueue.isEmpty()) {
+        return;
+    }
+
+    // Objects removed since, e.g. by a redisplay, are dropped; hidden ones
+    // are still meshed
+    QVector<Tessellator::LevelJob> jobs;
+    for (const LevelRequest& request : m_levelRequests) {
+        if (m_context->DisplayStatus(request.shape) == AIS_DS_None) continue;
+        Tessellator::LevelJob job;
+        job.shape = request.shape->Shape();
+        job.level = request.level;
+        job.diagonal = request.shape->diagonalLength();
+        jobs.append(job);
+        m_levelJob.append(request);
+    }
+    m_levelRequests.clear();
+    if (jobs.isEmpty()) return;
+
+    m_meshGeneration = m_displayGeneration;
+    m_tessellator->startLevels(jobs);
+}
+
+void CadView::onLevelsMeshed() {
+    QVector<Tessellator::LevelJob> jobs = m_tessellator->takeLevels();
+    QVector<LevelRequest> requests;
+    requests.swap(m_levelJob);
+    for (int i = 0; i < jobs.size() && i < requests.size(); ++i) {
+        requests[i].shape->setLevel(jobs[i].level, jobs[i].mesh);
+    }
+
+    // Display work held back while the job ran goes first
+    if (m_document && m_meshGeneration != m_displayGeneration) {
+        displayAllFeatures();
+    } else if (!m_displayQueue.isEmpty()) {
+        m_displayTimer->start();
+    }
+    refreshView();
+    startLevelMeshing();
+}
+
+Handle(AIS_InteractiveObject) CadView::featureObject(int featureId) const {
+    return m_featureObjects.value(featureId);
+}
+
+void CadView::cacheActivePlane() {
     CustomPlane plane;
     if (!m_pendingSketch.IsNull() && m_document) {
         plane = m_document->getSketchPlane(m_pendingSketch);
     } else {
         switch (m_currentView) {
-        case SketchView::Top:
-        case SketchView::Bottom:
-            plane = CustomPlane::XY();
-            break;
         case SketchView::Front:
         case SketchView::Back:
             plane = CustomPlane::XZ();
@@ -273,261 +769,360 @@ void CadView::updateRubberBand() {
         }
     }
 
-    // Helper to convert plane to 3D
-    auto planeToWorld = [&plane](const QVector2D& planePt) -> gp_Pnt {
-        QVector3D worldPt = plane.origin + plane.uAxis * planePt.x() + plane.vAxis * planePt.y();
-        return gp_Pnt(worldPt.x(), worldPt.y(), worldPt.z());
-    };
-
-    if (m_rubberBandMode == RubberBandMode::Line) {
-        if (m_sketchPoints.isEmpty()) return;
-
-        // Create line from base point to current point
-        Handle(Graphic3d_ArrayOfPolylines) polyline = new Graphic3d_ArrayOfPolylines(2);
-        polyline->AddVertex(planeToWorld(m_sketchPoints[0]));
-        polyline->AddVertex(planeToWorld(m_currentPoint));
-
-        // Create presentation
-        Handle(Prs3d_Presentation) prs = new Prs3d_Presentation(m_context->MainPrsMgr()->StructureManager());
-        Handle(Prs3d_LineAspect) aspect = new Prs3d_LineAspect(
-            Quantity_NOC_WHITE,
-            Aspect_TOL_DASH,
-            2.0
-            );
-
-        Handle(Graphic3d_Group) group = prs->NewGroup();
-        group->SetGroupPrimitivesAspect(aspect->Aspect());
-        group->AddPrimitiveArray(polyline);
-
-        prs->SetZLayer(Graphic3d_ZLayerId_Top);
-        prs->SetDisplayPriority(10);
-        prs->Display();
-
-        m_rubberBandObject = prs;
-    }
-    else if (m_rubberBandMode == RubberBandMode::Rectangle) {
-        // Create rectangle points
-        QVector2D p1 = m_sketchPoints[0];
-        QVector2D p2 = m_currentPoint;
-
-        gp_Pnt gp1 = planeToWorld(QVector2D(p1.x(), p1.y()));
-        gp_Pnt gp2 = planeToWorld(QVector2D(p2.x(), p1.y()));
-        gp_Pnt gp3 = planeToWorld(QVector2D(p2.x(), p2.y()));
-        gp_Pnt gp4 = planeToWorld(QVector2D(p1.x(), p2.y()));
-
-        // Create polyline array (5 points to close rectangle)
-        Handle(Graphic3d_ArrayOfPolylines) polyline = new Graphic3d_ArrayOfPolylines(5);
-        polyline->AddVertex(gp1);
-        polyline->AddVertex(gp2);
-        polyline->AddVertex(gp3);
-        polyline->AddVertex(gp4);
-        polyline->AddVertex(gp1); // Close the loop
-
-        // Create presentation
-        Handle(Prs3d_Presentation) prs = new Prs3d_Presentation(m_context->MainPrsMgr()->StructureManager());
-
-        // Set line attributes (white dashed line)
-        Handle(Prs3d_LineAspect) aspect = new Prs3d_LineAspect(
-            Quantity_NOC_WHITE,
-            Aspect_TOL_DASH,
-            2.0
-            );
-
-        // Create group and add polyline
-        Handle(Graphic3d_Group) group = prs->NewGroup();
-        group->SetGroupPrimitivesAspect(aspect->Aspect());
-        group->AddPrimitiveArray(polyline);
-
-        // Display presentation
-        prs->SetZLayer(Graphic3d_ZLayerId_Top);
-        prs->SetDisplayPriority(10);
-        prs->Display();
-
-        m_rubberBandObject = prs;
-
-    } else if (m_rubberBandMode == RubberBandMode::Polyline) {
-        if (m_sketchPoints.size() < 1) return;
+    // Sketch planes have orthonormal axes, so projecting onto them is
+    // the inverse of toWorld
+    m_pickPlane.plane = plane;
+    m_pickPlane.origin = gp_Pnt(plane.origin.x(), plane.origin.y(), plane.origin.z());
+    m_pickPlane.normal = gp_Vec(gp_Dir(plane.normal.x(), plane.normal.y(), plane.normal.z()));
+    m_pickPlane.uAxis = gp_Vec(gp_Dir(plane.uAxis.x(), plane.uAxis.y(), plane.uAxis.z()));
+    m_pickPlane.vAxis = gp_Vec(gp_Dir(plane.vAxis.x(), plane.vAxis.y(), plane.vAxis.z()));
+}
 
-        // Create polyline with all clicked points plus current point
-        int numPoints = m_sketchPoints.size() + 1;
-        Handle(Graphic3d_ArrayOfPolylines) polyline = new Graphic3d_ArrayOfPolylines(numPoints);
+void CadView::initOverlay(Overlay& overlay, Quantity_NameOfColor color,
+                          Aspect_TypeOfLine lineType, double width, bool segments) {
+    overlay.presentation = new Prs3d_Presentation(m_context->MainPrsMgr()->StructureManager());
+    overlay.presentation->SetZLayer(m_overlayLayer);
+    overlay.presentation->SetDisplayPriority(10);
+    // Vertices move without the bounding box being recomputed
+    overlay.presentation->SetInfiniteState(Standard_True);
+
+    Handle(Prs3d_LineAspect) aspect = new Prs3d_LineAspect(color, lineType, width);
+    overlay.aspect = aspect->Aspect();
+    overlay.group = overlay.presentation->NewGroup();
+    overlay.segments = segments;
+}
 
-        for (const QVector2D& pt : m_sketchPoints) {
-            polyline->AddVertex(planeToWorld(pt));
+void CadView::setOverlayVertices(Overlay& overlay, const QVector<gp_Pnt>& points) {
+    if (overlay.vertices.IsNull() || overlay.vertices->VertexNumber() != points.size()) {
+        if (overlay.segments) {
+            overlay.vertices = new Graphic3d_ArrayOfSegments(points.size(), 0, Graphic3d_ArrayFlags_AttribsMutable);
+        } else {
+            overlay.vertices = new Graphic3d_ArrayOfPolylines(points.size(), 0, 0, Graphic3d_ArrayFlags_AttribsMutable);
+        }
+        for (const gp_Pnt& point : points) {
+            overlay.vertices->AddVertex(point);
         }
-        polyline->AddVertex(planeToWorld(m_currentPoint));
-
-        // Create presentation
-        Handle(Prs3d_Presentation) prs = new Prs3d_Presentation(m_context->MainPrsMgr()->StructureManager());
-
-        Handle(Prs3d_LineAspect) aspect = new Prs3d_LineAspect(
-            Quantity_NOC_WHITE,
-            Aspect_TOL_DASH,
-            2.0
-            );
-
-        Handle(Graphic3d_Group) group = prs->NewGroup();
-        group->SetGroupPrimitivesAspect(aspect->Aspect());
-        group->AddPrimitiveArray(polyline);
-
-        prs->SetZLayer(Graphic3d_ZLayerId_Top);
-        prs->SetDisplayPriority(10);
-        prs->Display();
 
-        m_rubberBandObject = prs;
+        overlay.group->Clear(Standard_False);
+        overlay.group->SetGroupPrimitivesAspect(overlay.aspect);
+        overlay.group->AddPrimitiveArray(overlay.vertices);
+        return;
     }
 
-    m_view->Redraw();
+    for (int i = 0; i < points.size(); ++i) {
+        overlay.vertices->SetVertice(i + 1, points[i]);
+    }
+    Handle(Graphic3d_AttribBuffer) attribs = Handle(Graphic3d_AttribBuffer)::DownCast(overlay.vertices->Attributes());
+    if (!attribs.IsNull()) {
+        attribs->Invalidate(0, points.size() - 1);
+    }
 }
 
-void CadView::clearRubberBand() {
-    if (!m_rubberBandObject.IsNull()) {
-        m_rubberBandObject->Clear();
-        m_rubberBandObject->Erase();
-        m_rubberBandObject.Nullify();
+void CadView::showOverlay(Overlay& overlay) {
+    if (!overlay.presentation->IsDisplayed()) {
+        overlay.presentation->Display();
     }
 }
 
-TopoDS_Shape CadView::createPolylineShape(const QVector<QVector2D>& points, const CustomPlane& plane) {
-    if (points.size() < 2) return TopoDS_Shape();
-
-    try {
-        BRepBuilderAPI_MakeWire wireBuilder;
+void CadView::updateRubberBand() {
+    if (m_context.IsNull()) return;
 
-        for (int i = 0; i < points.size() - 1; ++i) {
-            QVector3D p1_3d = plane.origin + plane.uAxis * points[i].x() + plane.vAxis * points[i].y();
-            QVector3D p2_3d = plane.origin + plane.uAxis * points[i+1].x() + plane.vAxis * points[i+1].y();
+    if (m_mode != CadMode::Sketching || m_sketchPoints.isEmpty() || !m_hasCurrentPoint) {
+        clearRubberBand();
+        return;
+    }
 
-            gp_Pnt gp1(p1_3d.x(), p1_3d.y(), p1_3d.z());
-            gp_Pnt gp2(p2_3d.x(), p2_3d.y(), p2_3d.z());
+    const CustomPlane& plane = activePlane();
+    Overlay* band = nullptr;
+    m_overlayPoints.clear();
 
-            if (gp1.Distance(gp2) > Precision::Confusion()) {
-                BRepBuilderAPI_MakeEdge edgeBuilder(gp1, gp2);
-                if (edgeBuilder.IsDone()) {
-                    wireBuilder.Add(edgeBuilder.Edge());
-                }
-            }
+    if (m_rubberBandMode == RubberBandMode::Line) {
+        // Line from base point to current point
+        band = &m_lineBand;
+        m_overlayPoints.append(plane.toWorld(m_sketchPoints[0].X(), m_sketchPoints[0].Y()));
+        m_overlayPoints.append(plane.toWorld(m_currentPoint.X(), m_currentPoint.Y()));
+    } else if (m_rubberBandMode == RubberBandMode::Rectangle) {
+        // 5 points to close the rectangle
+        band = &m_rectangleBand;
+        gp_Pnt2d p1 = m_sketchPoints[0];
+        gp_Pnt2d p2 = m_currentPoint;
+        m_overlayPoints.append(plane.toWorld(p1.X(), p1.Y()));
+        m_overlayPoints.append(plane.toWorld(p2.X(), p1.Y()));
+        m_overlayPoints.append(plane.toWorld(p2.X(), p2.Y()));
+        m_overlayPoints.append(plane.toWorld(p1.X(), p2.Y()));
+        m_overlayPoints.append(m_overlayPoints.first());
+    } else if (m_rubberBandMode == RubberBandMode::Polyline) {
+        // All clicked points plus the current point
+        band = &m_polylineBand;
+        for (const gp_Pnt2d& pt : m_sketchPoints) {
+            m_overlayPoints.append(plane.toWorld(pt.X(), pt.Y()));
         }
+        m_overlayPoints.append(plane.toWorld(m_currentPoint.X(), m_currentPoint.Y()));
+    } else {
+        clearRubberBand();
+        return;
+    }
 
-        if (wireBuilder.IsDone()) {
-            return wireBuilder.Wire();
-        }
-    } catch (...) {
+    if (m_shownRubberBand && m_shownRubberBand != band) {
+        m_shownRubberBand->presentation->Erase();
     }
 
-    return TopoDS_Shape();
+    setOverlayVertices(*band, m_overlayPoints);
+    showOverlay(*band);
+    m_shownRubberBand = band;
 }
 
-TopoDS_Shape CadView::createExtrudeShape(TDF_Label sketchLabel, double height) {
-    if (sketchLabel.IsNull() || !m_document) return TopoDS_Shape();
+void CadView::clearRubberBand() {
+    if (!m_shownRubberBand) return;
 
-    QVector<QVector<QVector2D>> polylines = m_document->getSketchPolylines(sketchLabel);
-    if (polylines.isEmpty()) return TopoDS_Shape();
+    m_shownRubberBand->presentation->Erase();
+    m_shownRubberBand = nullptr;
+    if (!m_view.IsNull()) {
+        redrawOverlays();
+    }
+}
 
-    CustomPlane plane = m_document->getSketchPlane(sketchLabel);
+void CadView::updateCrosshair() {
+    if (m_context.IsNull() || !m_hasCurrentPoint) return;
 
-    const QVector<QVector2D>& points = polylines.first();
-    if (points.size() < 3) return TopoDS_Shape();
+    // Long enough to cross the whole viewport at the current zoom
+    double halfLength = m_view->Convert(Standard_Integer(qMax(width(), height())));
+    const CustomPlane& plane = activePlane();
+    double u = m_currentPoint.X();
+    double v = m_currentPoint.Y();
 
-    try {
-        BRepBuilderAPI_MakeWire wireBuilder;
+    m_overlayPoints.clear();
+    m_overlayPoints.append(plane.toWorld(u - halfLength, v));
+    m_overlayPoints.append(plane.toWorld(u + halfLength, v));
+    m_overlayPoints.append(plane.toWorld(u, v - halfLength));
+    m_overlayPoints.append(plane.toWorld(u, v + halfLength));
 
-        for (int i = 0; i < points.size(); ++i) {
-            int next = (i + 1) % points.size();
+    setOverlayVertices(m_crosshair, m_overlayPoints);
+    showOverlay(m_crosshair);
+}
 
-            QVector3D p1_3d = plane.origin + plane.uAxis * points[i].x() + plane.vAxis * points[i].y();
-            QVector3D p2_3d = plane.origin + plane.uAxis * points[next].x() + plane.vAxis * points[next].y();
+void CadView::clearCrosshair() {
+    if (m_crosshair.presentation.IsNull() || !m_crosshair.presentation->IsDisplayed()) return;
 
-            gp_Pnt gp1(p1_3d.x(), p1_3d.y(), p1_3d.z());
-            gp_Pnt gp2(p2_3d.x(), p2_3d.y(), p2_3d.z());
+    m_crosshair.presentation->Erase();
+    if (!m_view.IsNull()) {
+        redrawOverlays();
+    }
+}
 
-            if (gp1.Distance(gp2) > Precision::Confusion()) {
-                BRepBuilderAPI_MakeEdge edgeBuilder(gp1, gp2);
-                if (edgeBuilder.IsDone()) {
-                    wireBuilder.Add(edgeBuilder.Edge());
-                }
-            }
-        }
+void CadView::syncSnapEngine() {
+    if (m_pendingSketch.IsNull() || !m_document) {
+        m_snapEngine.clear();
+        m_snapSource = SketchPolylineSet();
+        return;
+    }
 
-        if (!wireBuilder.IsDone()) return TopoDS_Shape();
+    SketchPolylineSet polylines = m_document->getSketchPolylines(m_pendingSketch);
+    if (polylines.coords.constData() == m_snapSource.coords.constData()
+        && polylines.offsets.constData() == m_snapSource.offsets.constData()) {
+        return;
+    }
 
-        TopoDS_Wire wire = wireBuilder.Wire();
+    // Edits normally append polylines; index only those unless the
+    // existing ones changed (undo, reload)
+    const SketchPolylineSet& old = m_snapSource;
+    bool appended = m_snapEngine.polylineCount() == old.polylineCount()
+        && polylines.offsets.size() >= old.offsets.size()
+        && polylines.coords.size() >= old.coords.size()
+        && std::equal(old.offsets.begin(), old.offsets.end(), polylines.offsets.begin())
+        && std::equal(old.coords.begin(), old.coords.end(), polylines.coords.begin());
+    if (appended) {
+        for (int k = old.polylineCount(); k < polylines.polylineCount(); ++k) {
+            SketchPolylineView view = polylines.polyline(k);
+            m_snapEngine.appendPolyline(view.xy, view.pointCount);
+        }
+    } else {
+        m_snapEngine.setPolylines(polylines);
+    }
+    m_snapSource = polylines;
+}
 
-        gp_Pln gpPlane = plane.toGpPln();
-        BRepBuilderAPI_MakeFace faceBuilder(gpPlane, wire);
+gp_Pnt2d CadView::snapToGeometry(const gp_Pnt2d& point) {
+    // Snap aperture in pixels
+    const int aperture = 10;
 
-        if (!faceBuilder.IsDone()) return TopoDS_Shape();
+    m_lastSnap.type = SnapEngine::None;
+    if (m_snapTypes == SnapEngine::None || m_snapEngine.segmentCount() == 0 || m_view.IsNull()) {
+        return point;
+    }
 
-        TopoDS_Face face = faceBuilder.Face();
+    double from[2] = { 0.0, 0.0 };
+    if (!m_sketchPoints.isEmpty()) {
+        from[0] = m_sketchPoints.last().X();
+        from[1] = m_sketchPoints.last().Y();
+    }
+    m_lastSnap = m_snapEngine.query(point.X(), point.Y(), m_view->Convert(Standard_Integer(aperture)),
+                                    m_snapTypes, m_sketchPoints.isEmpty() ? nullptr : from);
+    if (m_lastSnap.type == SnapEngine::None) return point;
+    return gp_Pnt2d(m_lastSnap.u, m_lastSnap.v);
+}
 
-        gp_Vec extrudeVec(plane.normal.x() * height,
-                          plane.normal.y() * height,
-                          plane.normal.z() * height);
+void CadView::updateSnapMarker() {
+    if (m_snapMarker.presentation.IsNull()) return;
 
-        BRepPrimAPI_MakePrism prismBuilder(face, extrudeVec);
+    if (m_lastSnap.type == SnapEngine::None) {
+        m_snapMarker.presentation->Erase();
+        return;
+    }
 
-        if (prismBuilder.IsDone()) {
-            return prismBuilder.Shape();
-        }
-    } catch (...) {
+    // One glyph per snap type, a fixed size on screen: square, triangle,
+    // cross, perpendicular sign, hourglass
+    const CustomPlane& plane = activePlane();
+    double h = m_view->Convert(Standard_Integer(6));
+    double u = m_lastSnap.u;
+    double v = m_lastSnap.v;
+    QVector<gp_Pnt2d> ends;
+    switch (m_lastSnap.type) {
+    case SnapEngine::Endpoint:
+        ends << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v - h)
+             << gp_Pnt2d(u + h, v - h) << gp_Pnt2d(u + h, v + h)
+             << gp_Pnt2d(u + h, v + h) << gp_Pnt2d(u - h, v + h)
+             << gp_Pnt2d(u - h, v + h) << gp_Pnt2d(u - h, v - h);
+        break;
+    case SnapEngine::Midpoint:
+        ends << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v - h)
+             << gp_Pnt2d(u + h, v - h) << gp_Pnt2d(u, v + h)
+             << gp_Pnt2d(u, v + h) << gp_Pnt2d(u - h, v - h);
+        break;
+    case SnapEngine::Intersection:
+        ends << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v + h)
+             << gp_Pnt2d(u - h, v + h) << gp_Pnt2d(u + h, v - h);
+        break;
+    case SnapEngine::Perpendicular:
+        ends << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v - h)
+             << gp_Pnt2d(u, v - h) << gp_Pnt2d(u, v + h);
+        break;
+    default:
+        ends << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v + h)
+             << gp_Pnt2d(u - h, v + h) << gp_Pnt2d(u + h, v - h)
+             << gp_Pnt2d(u - h, v + h) << gp_Pnt2d(u + h, v + h)
+             << gp_Pnt2d(u - h, v - h) << gp_Pnt2d(u + h, v - h);
+        break;
     }
 
-    return TopoDS_Shape();
+    m_overlayPoints.clear();
+    for (const gp_Pnt2d& end : ends) {
+        m_overlayPoints.append(plane.toWorld(end.X(), end.Y()));
+    }
+    setOverlayVertices(m_snapMarker, m_overlayPoints);
+    showOverlay(m_snapMarker);
 }
 
 void CadView::updateGrid() {
-    clearGrid();
-
-    if (m_pendingSketch.IsNull() || !m_document) return;
-
-    CustomPlane plane = m_document->getSketchPlane(m_pendingSketch);
-
-    // Grid parameters
-    const int gridSize = 20;
-    const float gridSpacing = 10.0f;
+    // Keep minor lines at least this many pixels apart, and never emit
+    // more lines than this per direction
+    const double minPixelGap = 8.0;
+    const int maxLines = 400;
 
-    float halfSize = gridSize * gridSpacing / 2.0f;
-
-    // Create polylines for grid (each line is a separate 2-vertex polyline)
-    Handle(Graphic3d_ArrayOfPolylines) lines =
-        new Graphic3d_ArrayOfPolylines(2 * (gridSize + 1) * 2, gridSize * 2 + 2);
+    if (m_pendingSketch.IsNull() || !m_document || m_view.IsNull() || m_view->Window().IsNull()) {
+        clearGrid();
+        return;
+    }
 
-    // Grid lines parallel to U axis
-    for (int i = 0; i <= gridSize; ++i) {
-        float v = -halfSize + i * gridSpacing;
-        QVector3D p1 = plane.origin + plane.uAxis * (-halfSize) + plane.vAxis * v;
-        QVector3D p2 = plane.origin + plane.uAxis * halfSize + plane.vAxis * v;
+    const CustomPlane& plane = activePlane();
+    Standard_Integer width, height;
+    m_view->Window()->Size(width, height);
 
-        lines->AddBound(2);
-        lines->AddVertex(gp_Pnt(p1.x(), p1.y(), p1.z()));
-        lines->AddVertex(gp_Pnt(p2.x(), p2.y(), p2.z()));
+    // Spacing from the plane's scale at the view center: a power of ten
+    // for minor lines, every tenth line is major
+    double cu, cv, du, dv;
+    if (!pixelToPlane(width / 2, height / 2, cu, cv)
+        || !pixelToPlane(width / 2 + 10, height / 2, du, dv)) {
+        clearGrid();   // plane seen edge-on
+        return;
+    }
+    double unitsPerPixel = std::sqrt((du - cu) * (du - cu) + (dv - cv) * (dv - cv)) / 10.0;
+    if (unitsPerPixel <= 0.0) {
+        clearGrid();
+        return;
+    }
+    double minor = std::pow(10.0, std::ceil(std::log10(minPixelGap * unitsPerPixel)));
+    double major = minor * 10.0;
+
+    // Visible range from the view corners, limited around the center for
+    // perspective views looking toward the horizon
+    double limit = maxLines / 2 * minor;
+    double umin = cu, umax = cu, vmin = cv, vmax = cv;
+    const int xs[2] = { 0, width };
+    const int ys[2] = { 0, height };
+    for (int i = 0; i < 4; ++i) {
+        double u, v;
+        if (!pixelToPlane(xs[i & 1], ys[i >> 1], u, v)) {
+            u = cu + (i & 1 ? limit : -limit);
+            v = cv + (i >> 1 ? limit : -limit);
+        }
+        umin = qMin(umin, u);
+        umax = qMax(umax, u);
+        vmin = qMin(vmin, v);
+        vmax = qMax(vmax, v);
+    }
+    umin = qMax(umin, cu - limit);
+    umax = qMin(umax, cu + limit);
+    vmin = qMax(vmin, cv - limit);
+    vmax = qMin(vmax, cv + limit);
+
+    // Snapped to major cells, so panning within a cell rebuilds nothing
+    GridState grid;
+    grid.minor = minor;
+    grid.u0 = int(std::floor(umin / major));
+    grid.u1 = int(std::ceil(umax / major));
+    grid.v0 = int(std::floor(vmin / major));
+    grid.v1 = int(std::ceil(vmax / major));
+    if (!m_gridPresentation.IsNull() && grid.minor == m_grid.minor
+        && grid.u0 == m_grid.u0 && grid.u1 == m_grid.u1
+        && grid.v0 == m_grid.v0 && grid.v1 == m_grid.v1) {
+        return;
+    }
+    m_grid = grid;
+
+    int uLines = (grid.u1 - grid.u0) * 10 + 1;
+    int vLines = (grid.v1 - grid.v0) * 10 + 1;
+    int majorLines = (grid.u1 - grid.u0 + 1) + (grid.v1 - grid.v0 + 1);
+    Handle(Graphic3d_ArrayOfSegments) minorLines =
+        new Graphic3d_ArrayOfSegments(2 * (uLines + vLines - majorLines));
+    Handle(Graphic3d_ArrayOfSegments) majorLineArray =
+        new Graphic3d_ArrayOfSegments(2 * majorLines);
+
+    double u0 = grid.u0 * major, u1 = grid.u1 * major;
+    double v0 = grid.v0 * major, v1 = grid.v1 * major;
+    for (int i = 0; i < uLines; ++i) {
+        double u = u0 + i * minor;
+        const Handle(Graphic3d_ArrayOfSegments)& lines = (i % 10 == 0) ? majorLineArray : minorLines;
+        lines->AddVertex(plane.toWorld(u, v0));
+        lines->AddVertex(plane.toWorld(u, v1));
+    }
+    for (int i = 0; i < vLines; ++i) {
+        double v = v0 + i * minor;
+        const Handle(Graphic3d_ArrayOfSegments)& lines = (i % 10 == 0) ? majorLineArray : minorLines;
+        lines->AddVertex(plane.toWorld(u0, v));
+        lines->AddVertex(plane.toWorld(u1, v));
     }
 
-    // Grid lines parallel to V axis
-    for (int i = 0; i <= gridSize; ++i) {
-        float u = -halfSize + i * gridSpacing;
-        QVector3D p1 = plane.origin + plane.uAxis * u + plane.vAxis * (-halfSize);
-        QVector3D p2 = plane.origin + plane.uAxis * u + plane.vAxis * halfSize;
-
-        lines->AddBound(2);
-        lines->AddVertex(gp_Pnt(p1.x(), p1.y(), p1.z()));
-        lines->AddVertex(gp_Pnt(p2.x(), p2.y(), p2.z()));
+    if (m_gridPresentation.IsNull()) {
+        m_gridPresentation = new Prs3d_Presentation(
+            m_context->MainPrsMgr()->StructureManager());
+        m_gridPresentation->SetZLayer(Graphic3d_ZLayerId_Default);
     }
+    m_gridPresentation->Clear();
 
-    m_gridPresentation = new Prs3d_Presentation(
-        m_context->MainPrsMgr()->StructureManager());
+    Handle(Prs3d_LineAspect) minorAspect = new Prs3d_LineAspect(
+        Quantity_NOC_GRAY30, Aspect_TOL_SOLID, 1.0);
+    Handle(Graphic3d_Group) minorGroup = m_gridPresentation->NewGroup();
+    minorGroup->SetGroupPrimitivesAspect(minorAspect->Aspect());
+    minorGroup->AddPrimitiveArray(minorLines);
 
-    Handle(Prs3d_LineAspect) aspect = new Prs3d_LineAspect(
+    Handle(Prs3d_LineAspect) majorAspect = new Prs3d_LineAspect(
         Quantity_NOC_GRAY60, Aspect_TOL_SOLID, 1.0);
+    Handle(Graphic3d_Group) majorGroup = m_gridPresentation->NewGroup();
+    majorGroup->SetGroupPrimitivesAspect(majorAspect->Aspect());
+    majorGroup->AddPrimitiveArray(majorLineArray);
 
-    Handle(Graphic3d_Group) group = m_gridPresentation->NewGroup();
-    group->SetGroupPrimitivesAspect(aspect->Aspect());
-    group->AddPrimitiveArray(lines);
-
-    m_gridPresentation->SetZLayer(Graphic3d_ZLayerId_Default);
     m_gridPresentation->Display();
-
-    m_view->Redraw();
 }
 
 void CadView::clearGrid() {
@@ -539,7 +1134,45 @@ void CadView::clearGrid() {
 }
 
 void CadView::highlightFeature(int featureId) {
-    update();
+    // Remembered so features displayed later (lazy streaming, redisplay)
+    // come up highlighted
+    m_highlightedFeature = featureId;
+
+    m_context->ClearSelected(Standard_False);
+    Handle(AIS_InteractiveObject) object = featureObject(featureId);
+    if (!object.IsNull() && m_context->IsDisplayed(object)) {
+        m_context->AddOrRemoveSelected(object, Standard_False);
+    }
+    m_context->UpdateCurrentViewer();
+}
+
+void CadView::setFeatureVisible(int featureId, bool visible) {
+    Handle(AIS_InteractiveObject) object = featureObject(featureId);
+    if (object.IsNull()) return;
+
+    if (visible) {
+        m_context->Display(object, Standard_False);
+    } else {
+        m_context->Erase(object, Standard_False);
+    }
+    m_context->UpdateCurrentViewer();
+}
+
+void CadView::setFeatureColor(int featureId, const Quantity_Color& color) {
+    m_featureColors.insert(featureId, color);
+
+    Handle(AIS_InteractiveObject) object = featureObject(featureId);
+    if (object.IsNull()) return;
+    m_context->SetColor(object, color, Standard_True);
+}
+
+void CadView::setMode(CadMode mode) {
+    m_mode = mode;
+    if (m_mode != CadMode::Sketching && m_mode != CadMode::GetPoint) {
+        m_lastSnap.type = SnapEngine::None;
+        updateSnapMarker();
+        clearCrosshair();
+    }
 }
 
 void CadView::setRubberBandMode(RubberBandMode mode) {
@@ -551,102 +1184,63 @@ void CadView::setRubberBandMode(RubberBandMode mode) {
 
 void CadView::setPendingSketch(TDF_Label sketch) {
     m_pendingSketch = sketch;
-    updateGrid();
+    cacheActivePlane();
+    syncSnapEngine();
+    // Grid lines depend on the plane, not only the view
+    clearGrid();
+    if (!m_view.IsNull()) redrawScene();
 }
 
-QVector2D CadView::screenToPlane(const QPoint& screenPos) {
-    if (m_view.IsNull()) return QVector2D(0, 0);
+gp_Pnt2d CadView::screenToPlane(const QPoint& screenPos) {
+    if (m_view.IsNull()) return gp_Pnt2d(0, 0);
 
     // Convert Qt coordinates to OCCT coordinates
     Standard_Integer xp, yp;
     QtToOCCT(this, screenPos, xp, yp);
 
-    // Get the sketch plane
-    CustomPlane plane;
-    if (!m_pendingSketch.IsNull() && m_document) {
-        plane = m_document->getSketchPlane(m_pendingSketch);
-    } else {
-        switch (m_currentView) {
-        case SketchView::Top:
-        case SketchView::Bottom:
-            plane = CustomPlane::XY();
-            break;
-        case SketchView::Front:
-        case SketchView::Back:
-            plane = CustomPlane::XZ();
-            break;
-        case SketchView::Right:
-        case SketchView::Left:
-            plane = CustomPlane::YZ();
-            break;
-        default:
-            plane = CustomPlane::XY();
-            break;
-        }
+    double u, v;
+    if (pixelToPlane(xp, yp, u, v)) {
+        return gp_Pnt2d(u, v);
     }
+    return gp_Pnt2d(0, 0);
+}
 
-    gp_Pln gpPlane = plane.toGpPln();
-
-    // Get projection direction and eye point
-    Standard_Real Xeye, Yeye, Zeye;
-    Standard_Real Xproj, Yproj, Zproj;
-
-    m_view->Eye(Xeye, Yeye, Zeye);
-    m_view->Proj(Xproj, Yproj, Zproj);
-
-    gp_Pnt eyePoint(Xeye, Yeye, Zeye);
-    gp_Dir projDir(Xproj, Yproj, Zproj);
+bool CadView::pixelToPlane(int xp, int yp, double& u, double& v) const {
+    const Handle(Graphic3d_Camera)& camera = m_view->Camera();
 
-    // Convert screen point to 3D world coordinates
-    Standard_Real Xv, Yv, Zv;
-    m_view->Convert(xp, yp, Xv, Yv, Zv);
-    gp_Pnt screenPoint3D(Xv, Yv, Zv);
+    // Picking ray: along the view direction through the converted screen
+    // point in orthographic views, from the eye through it in perspective
+    Standard_Real xv, yv, zv;
+    m_view->Convert(xp, yp, xv, yv, zv);
+    gp_Pnt screenPoint(xv, yv, zv);
 
-    // Create picking ray
     gp_Pnt rayStart;
-    gp_Dir rayDir;
-
-    if (m_view->Camera()->IsOrthographic()) {
-        // For orthographic projection, ray starts at the converted screen point
-        // and direction is the projection direction
-        rayStart = screenPoint3D;
-        rayDir = projDir;
+    gp_Vec rayDir;
+    if (camera->IsOrthographic()) {
+        rayStart = screenPoint;
+        rayDir = gp_Vec(camera->Direction());
     } else {
-        // For perspective projection, ray goes from eye through screen point
-        rayStart = eyePoint;
-        gp_Vec direction(eyePoint, screenPoint3D);
-        if (direction.Magnitude() < Precision::Confusion()) {
-            rayDir = projDir;
-        } else {
-            rayDir = gp_Dir(direction);
-        }
+        rayStart = camera->Eye();
+        rayDir = gp_Vec(rayStart, screenPoint);
     }
 
-    gp_Lin pickLine(rayStart, rayDir);
+    // Closed-form intersection with the cached plane
+    double denom = rayDir.Dot(m_pickPlane.normal);
+    if (std::abs(denom) <= 1.0e-12 * rayDir.Magnitude()) return false;
 
-    // Find intersection with plane
-    IntAna_IntConicQuad intersection(pickLine, gpPlane, Precision::Angular());
-
-    if (intersection.IsDone() && intersection.NbPoints() > 0) {
-        gp_Pnt intersectPnt = intersection.Point(1);
-
-        // Convert 3D world point to 2D plane coordinates
-        QVector3D worldPt(intersectPnt.X(), intersectPnt.Y(), intersectPnt.Z());
-        QVector3D localPt = worldPt - plane.origin;
-
-        float u = QVector3D::dotProduct(localPt, plane.uAxis);
-        float v = QVector3D::dotProduct(localPt, plane.vAxis);
-
-        return QVector2D(u, v);
-    }
+    gp_Vec toOrigin(rayStart, m_pickPlane.origin);
+    double t = toOrigin.Dot(m_pickPlane.normal) / denom;
+    if (!camera->IsOrthographic() && t <= 0.0) return false;   // behind the eye
 
-    return QVector2D(0, 0);
+    gp_Vec local = rayDir * t - toOrigin;
+    u = local.Dot(m_pickPlane.uAxis);
+    v = local.Dot(m_pickPlane.vAxis);
+    return true;
 }
 
 void CadView::paintEvent(QPaintEvent* event) {
     if (!m_view.IsNull()) {
-        m_view->InvalidateImmediate();
-        m_view->Redraw();
+        redrawScene();
     }
 }
 
@@ -670,11 +1264,14 @@ void CadView::resizeEvent(QResizeEvent* event) {
 // #endif
 
         m_view->MustBeResized();
-        m_view->Redraw();
+        redrawScene();
     }
 }
 
 void CadView::mousePressEvent(QMouseEvent* event) {
+    // Picks and sketch points must see the state the user was looking at
+    flushInput();
+
     m_lastMousePos = event->pos();
     m_mousePressed = true;
     m_pressedButton = event->button();
@@ -683,10 +1280,10 @@ void CadView::mousePressEvent(QMouseEvent* event) {
     Standard_Integer xp, yp;
     QtToOCCT(this, event->pos(), xp, yp);
 
-    // Update OCCT selection
+    // Update OCCT selection; Select redraws the viewer itself
     if (!m_context.IsNull() && !m_view.IsNull())
     {
-        m_context->MoveTo(xp, yp, m_view, Standard_True);
+        m_context->MoveTo(xp, yp, m_view, Standard_False);
 
         if (event->button() == Qt::LeftButton)
         {
@@ -704,7 +1301,7 @@ void CadView::mousePressEvent(QMouseEvent* event) {
     }
 
     if (m_mode == CadMode::Sketching && event->button() == Qt::LeftButton) {
-        QVector2D planePt = screenToPlane(event->pos());
+        gp_Pnt2d planePt = snapToGeometry(screenToPlane(event->pos()));
 
         if (m_rubberBandMode == RubberBandMode::Rectangle) {
             if (m_sketchPoints.isEmpty()) {
@@ -722,7 +1319,7 @@ void CadView::mousePressEvent(QMouseEvent* event) {
         }
     }
     if ( m_mode == CadMode::GetPoint && event->button() == Qt::LeftButton) {
-        QVector2D planePt = screenToPlane(event->pos());
+        gp_Pnt2d planePt = snapToGeometry(screenToPlane(event->pos()));
         // For getpoint with rubber band line - emit immediately
         Q_EMIT pointAcquired(planePt);  // <-- ADDED FOR GETPOINT
         clearRubberBand();
@@ -736,74 +1333,48 @@ void CadView::mousePressEvent(QMouseEvent* event) {
 }
 
 void CadView::mouseMoveEvent(QMouseEvent* event) {
-    // Convert to OCCT coordinates
-    Standard_Integer xp, yp;
-    QtToOCCT(this, event->pos(), xp, yp);
-
-    // Update OCCT hover detection
-    if (!m_context.IsNull() && !m_view.IsNull())
-    {
-        m_context->MoveTo(xp, yp, m_view, Standard_True);
-
-        if (m_context->HasDetected())
-        {
-            Handle(AIS_InteractiveObject) detected = m_context->DetectedInteractive();
-            if (!detected.IsNull() && detected == m_viewCube)
-            {
-                setCursor(Qt::PointingHandCursor);
-            }
-            else
-            {
-                unsetCursor();
-            }
-        }
-        else
-        {
-            unsetCursor();
-        }
-    }
-
-    // Sketching mode logic
-    if (m_mode == CadMode::Sketching) {
-        m_currentPoint = screenToPlane(event->pos());
-        m_hasCurrentPoint = true;
-        updateRubberBand();
-        return;
-    }
+    // Only record the input here; renderFrame applies everything that
+    // arrived since the previous frame in one go
+    m_pending.moved = true;
+    m_pending.pos = event->pos();
 
     // View manipulation
-    if (m_mousePressed && !m_view.IsNull()) {
-        int dx = event->pos().x() - m_lastMousePos.x();
-        int dy = event->pos().y() - m_lastMousePos.y();
-
+    if (m_mode != CadMode::Sketching && m_mousePressed && !m_view.IsNull()) {
         if (m_pressedButton == Qt::MiddleButton) {
-            m_view->Pan(dx, -dy);
+            m_pending.panDx += event->pos().x() - m_lastMousePos.x();
+            m_pending.panDy += event->pos().y() - m_lastMousePos.y();
         } else if (m_pressedButton == Qt::RightButton) {
-            // For rotation, just call Rotation with current position
-            m_view->Rotation(xp, yp);
+            // Rotation only needs the latest position
+            m_pending.rotate = true;
         }
-
-        update();
     }
 
     m_lastMousePos = event->pos();
+    scheduleFrame();
 }
 
 void CadView::mouseReleaseEvent(QMouseEvent* event) {
+    flushInput();
+    bool wasNavigating = isNavigating();
     m_mousePressed = false;
+
+    // Back to full detail once the view stops moving
+    if (wasNavigating && !m_view.IsNull() && updateLevelsOfDetail()) {
+        redrawScene();
+    }
 }
 
 void CadView::wheelEvent(QWheelEvent* event) {
     if (!m_view.IsNull()) {
-        Standard_Real currentScale = m_view->Scale();
         Standard_Real delta = event->angleDelta().y() / 120.0;
-        Standard_Real newScale = currentScale * (1.0 + delta * 0.1);
-        m_view->SetScale(newScale);
-        update();
+        m_pending.zoomFactor *= 1.0 + delta * 0.1;
+        scheduleFrame();
     }
 }
 
 void CadView::keyPressEvent(QKeyEvent* event) {
+    flushInput();
+
     if (m_mode == CadMode::Sketching) {
         if (event->key() == Qt::Key_Escape) {
             Q_EMIT getPointCancelled();
@@ -6,6 +6,8 @@
 #include <QWheelEvent>
 #include <QKeyEvent>
 #include <QTimer>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include <AIS_InteractiveContext.hxx>
 #include <V3d_View.hxx>
@@ -15,13 +17,22 @@
 #include <OpenGl_GraphicDriver.hxx>
 #include <AIS_Shape.hxx>
 #include <AIS_ViewCube.hxx>
+#include <Bnd_Box.hxx>
+#include <gp_Vec.hxx>
 #include <Graphic3d_ArrayOfPolylines.hxx>
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <Graphic3d_AspectLine3d.hxx>
+#include <Graphic3d_Group.hxx>
+#include <Graphic3d_ZLayerId.hxx>
 #include <Prs3d_LineAspect.hxx>
 #include <AIS_Line.hxx>
+#include <gp_Pnt2d.hxx>
 
+#include "LodShape.h"
 #include "OcafDocument.h"
+#include "Regenerator.h"
+#include "SnapEngine.h"
 
-#include <QVector2D>
 #include <QVector3D>
 #include <QPoint>
 
@@ -52,6 +63,7 @@ enum class RubberBandMode {
 };
 
 class OcafDocument;
+class Tessellator;
 
 class CadView : public QWidget {
     Q_OBJECT
@@ -66,27 +78,72 @@ public:
 
     Handle(AIS_InteractiveContext) getContext() const { return m_context; }
     Handle(V3d_View) getView() const { return m_view; }
+    Regenerator& regenerator() { return m_regenerator; }
 
     void displayAllFeatures();
     void displayFeature(TDF_Label label);
+    // Waits for the background mesh job, which writes triangulations into
+    // document shapes; call before reading them outside the GUI's own
+    // display path (snapshots, exports)
+    void waitForMeshing();
+
+    // Per-feature access through the feature ID -> AIS object registry;
+    // these touch only that feature's object. featureId -1 clears the
+    // highlight.
+    Handle(AIS_InteractiveObject) featureObject(int featureId) const;
     void highlightFeature(int featureId);
+    void setFeatureVisible(int featureId, bool visible);
+    void setFeatureColor(int featureId, const Quantity_Color& color);
+
+    // Object snaps applied to sketch and getpoint input; a mask of
+    // SnapEngine::SnapType, all enabled by default
+    void setSnapTypes(int types) { m_snapTypes = types; }
+    int snapTypes() const { return m_snapTypes; }
 
-    void setMode(CadMode mode) { m_mode = mode; }
+    // Between these, display calls are only recorded; the outermost
+    // endUpdate regenerates once and updates the viewer once
+    void beginUpdate();
+    void endUpdate();
+
+    void setMode(CadMode mode);
     CadMode getMode() const { return m_mode; }
 
     void setRubberBandMode(RubberBandMode mode);
     void setPendingSketch(TDF_Label sketch);
 
-    QVector2D screenToPlane(const QPoint& screenPos);
+    // Points on the sketch plane stay in double from the pick to the
+    // document, so snapped points land exactly on stored vertices
+    gp_Pnt2d screenToPlane(const QPoint& screenPos);
+    // Coordinates on the active plane under an OCCT window pixel; false
+    // if the pick ray misses the plane
+    bool pixelToPlane(int xp, int yp, double& u, double& v) const;
 
     SketchView getCurrentView() const { return m_currentView; }
     void fitAll();
 
-    QVector<QVector2D> getSketchPoints() const { return m_sketchPoints; }
+    QVector<gp_Pnt2d> getSketchPoints() const { return m_sketchPoints; }
     RubberBandMode getRubberBandMode() const { return m_rubberBandMode; }
 
+    // Wall time of full scene redraws vs. overlay-only redraws
+    struct FrameStats {
+        int sceneFrames;
+        double sceneMs;
+        double sceneMaxMs;
+        int overlayFrames;
+        double overlayMs;
+        double overlayMaxMs;
+    };
+    const FrameStats& frameStats() const { return m_frameStats; }
+    void resetFrameStats();
+    QString frameStatsReport() const;
+
+    // Histogram of the time from the first input event of a frame until
+    // that frame has been presented
+    QString latencyReport() const;
+    void resetLatencyStats();
+
 Q_SIGNALS:
-    void pointAcquired(QVector2D point);
+    void pointAcquired(gp_Pnt2d point);
     void getPointCancelled();
     void getPointKeyPressed(QString key);
 
@@ -103,18 +160,152 @@ protected:
 
 private:
     void initializeViewer();
-    Handle(Prs3d_Presentation) m_rubberBandObject;
+    void presentFeature(TDF_Label label);
+    void removeFeatureObject(int featureId);
+    void clearFeatureObjects();
+
+    // Picks each LodShape's tessellation level from its on-screen size,
+    // one level coarser while the view is being panned or rotated;
+    // returns whether any level changed. Levels not meshed yet are
+    // requested and the nearest meshed one stays on screen meanwhile.
+    bool updateLevelsOfDetail();
+    void requestLevel(const Handle(LodShape)& lod, int level);
+    void startLevelMeshing();
+    void onLevelsMeshed();
+    double projectedSize(const Bnd_Box& box) const;
+    bool isNavigating() const;
+    void displayNextChunk();
+    QVector<TopoDS_Shape> extrudeShapes(const QVector<TDF_Label>& labels) const;
+    void presentWhenMeshed(const QVector<TDF_Label>& labels, bool fit);
+    void onFeaturesMeshed();
+    // The plane picking and overlays work on: the pending sketch's plane,
+    // else the one facing the current standard view. Resolved from OCAF
+    // only when those change, so mouse handling never touches the document.
+    struct PickPlane {
+        CustomPlane plane;
+        gp_Pnt origin;
+        gp_Vec normal;
+        gp_Vec uAxis;
+        gp_Vec vAxis;
+    };
+    PickPlane m_pickPlane;
+    void cacheActivePlane();
+    const CustomPlane& activePlane() const { return m_pickPlane.plane; }
+
+    // Persistent line overlay in the overlay Z-layer. Updates rewrite the
+    // vertices of its mutable array in place; the array is only replaced
+    // when the vertex count changes (e.g. a polyline click).
+    struct Overlay {
+        Handle(Prs3d_Presentation) presentation;
+        Handle(Graphic3d_Group) group;
+        Handle(Graphic3d_AspectLine3d) aspect;
+        Handle(Graphic3d_ArrayOfPrimitives) vertices;
+        // Vertex pairs instead of one connected polyline
+        bool segments;
+    };
+    Overlay m_lineBand;
+    Overlay m_rectangleBand;
+    Overlay m_polylineBand;
+    Overlay* m_shownRubberBand;
+    Overlay m_crosshair;
+    Overlay m_snapMarker;
+    QVector<gp_Pnt> m_overlayPoints;
+    void initOverlay(Overlay& overlay, Quantity_NameOfColor color,
+                     Aspect_TypeOfLine lineType, double width, bool segments);
+    void setOverlayVertices(Overlay& overlay, const QVector<gp_Pnt>& points);
+    void showOverlay(Overlay& overlay);
     void updateRubberBand();
     void clearRubberBand();
+    void updateCrosshair();
+    void clearCrosshair();
+
+    // Full redraws for persistent geometry, immediate redraws for the
+    // overlay layer only; both feed m_frameStats
+    void redrawScene();
+    void redrawOverlays();
+    Graphic3d_ZLayerId m_overlayLayer;
+    FrameStats m_frameStats;
 
-    TopoDS_Shape createPolylineShape(const QVector<QVector2D>& points, const CustomPlane& plane);
-    TopoDS_Shape createExtrudeShape(TDF_Label sketchLabel, double height);
+    // Mouse input received since the last frame. Moves only overwrite the
+    // position and add to the pan/zoom totals; renderFrame applies it all
+    // at most once per display refresh.
+    struct PendingInput {
+        bool any;
+        bool moved;
+        QPoint pos;
+        int panDx;
+        int panDy;
+        bool rotate;
+        double zoomFactor;
+        qint64 firstEventNs;
+    };
+    PendingInput m_pending;
+    QTimer* m_frameTimer;
+    QElapsedTimer m_clock;
+    qint64 m_lastFrameNs;
+    qint64 m_frameIntervalNs;
+    void resetPendingInput();
+    void scheduleFrame();
+    void flushInput();
+    void renderFrame();
+
+    QVector<int> m_latencyBuckets;
+    int m_latencyCount;
+    double m_latencySumMs;
+    double m_latencyMaxMs;
 
     Handle(AIS_InteractiveContext) m_context;
     Handle(V3d_View) m_view;
     Handle(V3d_Viewer) m_viewer;
 
     OcafDocument* m_document;
+    Regenerator m_regenerator;
+
+    int m_updateDepth;
+    bool m_pendingDisplayAll;
+    QVector<TDF_Label> m_pendingDisplay;
+
+    // Features of a lazily loaded document still waiting to be shown;
+    // drained a chunk per timer tick so the view stays interactive
+    QTimer* m_displayTimer;
+    QVector<TDF_Label> m_displayQueue;
+    bool m_displayFitted;
+
+    // Extrudes are meshed in the background before being presented;
+    // m_meshLabels waits for the running job. A display request made
+    // meanwhile bumps m_displayGeneration and is redone afterwards.
+    Tessellator* m_tessellator;
+    QVector<TDF_Label> m_meshLabels;
+    int m_displayGeneration;
+    int m_meshGeneration;
+    bool m_meshFit;
+
+    // Finer LodShape levels waiting for the tessellator, and the ones in
+    // its running job in Tessellator::LevelJob order. Level jobs only run
+    // while no features wait to be displayed.
+    struct LevelRequest {
+        Handle(LodShape) shape;
+        int level;
+    };
+    QVector<LevelRequest> m_levelRequests;
+    QVector<LevelRequest> m_levelJob;
+
+    // The AIS object currently displayed for each feature
+    QHash<int, Handle(AIS_InteractiveObject)> m_featureObjects;
+    // Colors set through setFeatureColor survive redisplay
+    QHash<int, Quantity_Color> m_featureColors;
+    int m_highlightedFeature;
+
+    // Segments of the pending sketch for object snapping. m_snapSource is
+    // what the engine was built from, so appended polylines can be
+    // indexed without rebuilding.
+    SnapEngine m_snapEngine;
+    SketchPolylineSet m_snapSource;
+    int m_snapTypes;
+    SnapEngine::Snap m_lastSnap;
+    void syncSnapEngine();
+    gp_Pnt2d snapToGeometry(const gp_Pnt2d& point);
+    void updateSnapMarker();
 
     SketchView m_currentView;
     CadMode m_mode;
@@ -126,13 +317,21 @@ private:
     bool m_mousePressed;
     Qt::MouseButton m_pressedButton;
 
-    QVector<QVector2D> m_sketchPoints;
-    QVector2D m_currentPoint;
+    QVector<gp_Pnt2d> m_sketchPoints;
+    gp_Pnt2d m_currentPoint;
     bool m_hasCurrentPoint;
     bool m_viewInitialized;
 
     Handle(AIS_ViewCube) m_viewCube;
+    // Sketch grid covering only the visible part of the sketch plane, in
+    // major cells of ten minor lines. Checked on every scene redraw and
+    // rebuilt only when the spacing or the covered cells change.
+    struct GridState {
+        double minor;
+        int u0, u1, v0, v1;   // covered major cells
+    };
     Handle(Prs3d_Presentation) m_gridPresentation;
+    GridState m_grid;
     void updateGrid();
     void clearGrid();
 };
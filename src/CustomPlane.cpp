@@ -0,0 +1,60 @@
+#include "CustomPlane.h"
+
+CustomPlane CustomPlane::XY() {
+    CustomPlane p;
+    p.origin = QVector3D(0, 0, 0);
+    p.normal = QVector3D(0, 0, 1);
+    p.uAxis = QVector3D(1, 0, 0);
+    p.vAxis = QVector3D(0, 1, 0);
+    return p;
+}
+
+CustomPlane CustomPlane::XZ() {
+    CustomPlane p;
+    p.origin = QVector3D(0, 0, 0);
+    p.normal = QVector3D(0, 1, 0);
+    p.uAxis = QVector3D(1, 0, 0);
+    p.vAxis = QVector3D(0, 0, 1);
+    return p;
+}
+
+CustomPlane CustomPlane::YZ() {
+    CustomPlane p;
+    p.origin = QVector3D(0, 0, 0);
+    p.normal = QVector3D(1, 0, 0);
+    p.uAxis = QVector3D(0, 1, 0);
+    p.vAxis = QVector3D(0, 0, 1);
+    return p;
+}
+
+QString CustomPlane::getDisplayName() const {
+    if (normal == QVector3D(0, 0, 1) && origin == QVector3D(0, 0, 0))
+        return "XY";
+    if (normal == QVector3D(0, 1, 0) && origin == QVector3D(0, 0, 0))
+        return "XZ";
+    if (normal == QVector3D(1, 0, 0) && origin == QVector3D(0, 0, 0))
+        return "YZ";
+    return QString("Custom (%1, %2, %3)")
+        .arg(normal.x(), 0, 'f', 2)
+        .arg(normal.y(), 0, 'f', 2)
+        .arg(normal.z(), 0, 'f', 2);
+}
+
+gp_Pln CustomPlane::toGpPln() const {
+    gp_Pnt origin_pnt(origin.x(), origin.y(), origin.z());
+    gp_Dir normal_dir(normal.x(), normal.y(), normal.z());
+    return gp_Pln(origin_pnt, normal_dir);
+}
+
+gp_Ax2 CustomPlane::toGpAx2() const {
+    gp_Pnt origin_pnt(origin.x(), origin.y(), origin.z());
+    gp_Dir normal_dir(normal.x(), normal.y(), normal.z());
+    gp_Dir uaxis_dir(uAxis.x(), uAxis.y(), uAxis.z());
+    return gp_Ax2(origin_pnt, normal_dir, uaxis_dir);
+}
+
+gp_Pnt CustomPlane::toWorld(double u, double v) const {
+    return gp_Pnt(origin.x() + uAxis.x() * u + vAxis.x() * v,
+                  origin.y() + uAxis.y() * u + vAxis.y() * v,
+                  origin.z() + uAxis.z() * u + vAxis.z() * v);
+}
@@ -0,0 +1,29 @@
+#ifndef CUSTOMPLANE_H
+#define CUSTOMPLANE_H
+
+#include <gp_Pnt.hxx>
+#include <gp_Dir.hxx>
+#include <gp_Ax2.hxx>
+#include <gp_Pln.hxx>
+
+#include <QString>
+#include <QVector3D>
+
+struct CustomPlane {
+    QVector3D origin;
+    QVector3D normal;
+    QVector3D uAxis;
+    QVector3D vAxis;
+
+    static CustomPlane XY();
+    static CustomPlane XZ();
+    static CustomPlane YZ();
+    QString getDisplayName() const;
+
+    gp_Pln toGpPln() const;
+    gp_Ax2 toGpAx2() const;
+    // Plane (u, v) to world, evaluated in double precision
+    gp_Pnt toWorld(double u, double v) const;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "DocumentDrivers.h"
+#include "SketchGeometryAttribute.h"
+
+#include <BinDrivers.hxx>
+#include <BinMDF_ADriverTable.hxx>
+#include <BinObjMgt_Persistent.hxx>
+#include <Message.hxx>
+
+IMPLEMENT_STANDARD_RTTIEXT(SketchGeometryDriver, BinMDF_ADriver)
+IMPLEMENT_STANDARD_RTTIEXT(DocumentStorageDriver, BinDrivers_DocumentStorageDriver)
+IMPLEMENT_STANDARD_RTTIEXT(DocumentRetrievalDriver, BinDrivers_DocumentRetrievalDriver)
+
+static const Standard_Integer SKETCH_GEOMETRY_VERSION = 1;
+
+// Bytes of source not read yet. Counts read from the file are checked
+// against it before anything is allocated for them.
+static qint64 remainingBytes(const BinObjMgt_Persistent& source) {
+    return qint64(source.Length()) - source.Position();
+}
+
+SketchGeometryDriver::SketchGeometryDriver(const Handle(Message_Messenger)& messenger)
+    : BinMDF_ADriver(messenger, NULL)
+{
+}
+
+Handle(TDF_Attribute) SketchGeometryDriver::NewEmpty() const {
+    return new SketchGeometryAttribute();
+}
+
+Standard_Boolean SketchGeometryDriver::Paste(const BinObjMgt_Persistent& source,
+                                             const Handle(TDF_Attribute)& target,
+                                             BinObjMgt_RRelocationTable& relocationTable) const {
+    (void)relocationTable;
+    Handle(SketchGeometryAttribute) geometry = Handle(SketchGeometryAttribute)::DownCast(target);
+
+    Standard_Integer version = 0;
+    Standard_Integer offsetCount = 0;
+    if (!(source >> version >> offsetCount)) return Standard_False;
+    if (version != SKETCH_GEOMETRY_VERSION || offsetCount < 1) return Standard_False;
+    if (offsetCount * qint64(sizeof(Standard_Integer)) > remainingBytes(source)) return Standard_False;
+
+    QVector<int> offsets(offsetCount);
+    if (!source.GetIntArray(offsets.data(), offsetCount)) return Standard_False;
+
+    Standard_Integer coordCount = 0;
+    if (!(source >> coordCount) || coordCount < 0) return Standard_False;
+    if (coordCount * qint64(sizeof(Standard_Real)) > remainingBytes(source)) return Standard_False;
+
+    QVector<double> coords(coordCount);
+    if (coordCount > 0 && !source.GetRealArray(coords.data(), coordCount)) return Standard_False;
+
+    // Enough to keep every polyline view inside the coordinates, as
+    // SketchFile::open checks its offset section
+    if (offsets.first() != 0 || 2 * qint64(offsets.last()) != coordCount) return Standard_False;
+    for (int k = 0; k + 1 < offsetCount; ++k) {
+        if (offsets[k + 1] < offsets[k]) return Standard_False;
+    }
+
+    geometry->setPacked(coords, offsets);
+    return Standard_True;
+}
+
+void SketchGeometryDriver::Paste(const Handle(TDF_Attribute)& source,
+                                 BinObjMgt_Persistent& target,
+                                 BinObjMgt_SRelocationTable& relocationTable) const {
+    (void)relocationTable;
+    Handle(SketchGeometryAttribute) geometry = Handle(SketchGeometryAttribute)::DownCast(source);
+
+    // An empty attribute is stored with just the leading offset
+    QVector<int> offsets = geometry->packedOffsets();
+    if (offsets.isEmpty()) offsets.append(0);
+    const QVector<double>& coords = geometry->packedCoordinates();
+
+    target << SKETCH_GEOMETRY_VERSION << Standard_Integer(offsets.size());
+    target.PutIntArray(const_cast<Standard_Integer*>(offsets.constData()), offsets.size());
+
+    target << Standard_Integer(coords.size());
+    if (!coords.isEmpty()) {
+        target.PutRealArray(const_cast<Standard_Real*>(coords.constData()), coords.size());
+    }
+}
+
+Handle(BinMDF_ADriverTable) DocumentStorageDriver::AttributeDrivers(const Handle(Message_Messenger)& messenger) {
+    Handle(BinMDF_ADriverTable) table = BinDrivers::AttributeDrivers(messenger);
+    table->AddDriver(new SketchGeometryDriver(messenger));
+    return table;
+}
+
+Handle(BinMDF_ADriverTable) DocumentRetrievalDriver::AttributeDrivers(const Handle(Message_Messenger)& messenger) {
+    Handle(BinMDF_ADriverTable) table = BinDrivers::AttributeDrivers(messenger);
+    table->AddDriver(new SketchGeometryDriver(messenger));
+    return table;
+}
+
+void DocumentDrivers::defineFormat(const Handle(TDocStd_Application)& app) {
+    Handle(DocumentStorageDriver) storage = new DocumentStorageDriver();
+    // Shapes are written next to their NamedShape attributes instead of in
+    // one trailing section, so a lazy load of a few features does not
+    // have to read every shape in the file
+    storage->EnableQuickPartWriting(Message::DefaultMessenger(), Standard_True);
+    // Keep display meshes with the shapes so reopening does not re-mesh
+    storage->SetWithTriangles(Message::DefaultMessenger(), Standard_True);
+
+    app->DefineFormat("BinOcaf", "Binary OCAF Document", "cbf",
+                      new DocumentRetrievalDriver(), storage);
+}
@@ -0,0 +1,53 @@
+#ifndef DOCUMENTDRIVERS_H
+#define DOCUMENTDRIVERS_H
+
+#include <BinMDF_ADriver.hxx>
+#include <BinDrivers_DocumentStorageDriver.hxx>
+#include <BinDrivers_DocumentRetrievalDriver.hxx>
+#include <TDocStd_Application.hxx>
+
+// Binary persistence of SketchGeometryAttribute. Layout: format version,
+// offset count and offsets, coordinate count and coordinates.
+class SketchGeometryDriver : public BinMDF_ADriver {
+public:
+    explicit SketchGeometryDriver(const Handle(Message_Messenger)& messenger);
+
+    Handle(TDF_Attribute) NewEmpty() const Standard_OVERRIDE;
+    Standard_Boolean Paste(const BinObjMgt_Persistent& source,
+                           const Handle(TDF_Attribute)& target,
+                           BinObjMgt_RRelocationTable& relocationTable) const Standard_OVERRIDE;
+    void Paste(const Handle(TDF_Attribute)& source,
+               BinObjMgt_Persistent& target,
+               BinObjMgt_SRelocationTable& relocationTable) const Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(SketchGeometryDriver, BinMDF_ADriver)
+};
+
+DEFINE_STANDARD_HANDLE(SketchGeometryDriver, BinMDF_ADriver)
+
+// The standard BinOcaf drivers plus the AICAD attribute drivers
+class DocumentStorageDriver : public BinDrivers_DocumentStorageDriver {
+public:
+    Handle(BinMDF_ADriverTable) AttributeDrivers(const Handle(Message_Messenger)& messenger) Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(DocumentStorageDriver, BinDrivers_DocumentStorageDriver)
+};
+
+DEFINE_STANDARD_HANDLE(DocumentStorageDriver, BinDrivers_DocumentStorageDriver)
+
+class DocumentRetrievalDriver : public BinDrivers_DocumentRetrievalDriver {
+public:
+    Handle(BinMDF_ADriverTable) AttributeDrivers(const Handle(Message_Messenger)& messenger) Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(DocumentRetrievalDriver, BinDrivers_DocumentRetrievalDriver)
+};
+
+DEFINE_STANDARD_HANDLE(DocumentRetrievalDriver, BinDrivers_DocumentRetrievalDriver)
+
+namespace DocumentDrivers {
+    // Registers the BinOcaf format with the AICAD drivers; replaces
+    // BinDrivers::DefineFormat
+    void defineFormat(const Handle(TDocStd_Application)& app);
+}
+
+#endif
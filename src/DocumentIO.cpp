@@ -0,0 +1,168 @@
+#include "DocumentIO.h"
+#include "PartialFile.h"
+
+#include <Message_ProgressIndicator.hxx>
+#include <Message_ProgressScope.hxx>
+
+#include <QFile>
+#include <QThread>
+
+namespace {
+    // Forwards progress to DocumentIO::progress and checks for cancellation.
+    // Runs on the worker thread; the signal is queued to the GUI thread.
+    class JobProgress : public Message_ProgressIndicator {
+    public:
+        JobProgress(DocumentIO* owner, const QAtomicInt* cancelled)
+            : m_owner(owner), m_cancelled(cancelled), m_lastPercent(-1) {}
+
+        Standard_Boolean UserBreak() Standard_OVERRIDE {
+            return m_cancelled->loadAcquire() != 0;
+        }
+
+        void Show(const Message_ProgressScope& scope, const Standard_Boolean force) Standard_OVERRIDE {
+            (void)scope;
+            (void)force;
+            int percent = int(GetPosition() * 100.0);
+            if (percent == m_lastPercent) return;
+            m_lastPercent = percent;
+            Q_EMIT m_owner->progress(percent);
+        }
+
+    private:
+        DocumentIO* m_owner;
+        const QAtomicInt* m_cancelled;
+        int m_lastPercent;
+    };
+}
+
+DocumentIO::DocumentIO(QObject* parent)
+    : QObject(parent)
+    , m_thread(nullptr)
+    , m_mode(LoadMode::Full)
+    , m_format(ShapeExporter::Step)
+    , m_missing(0)
+    , m_job(Save)
+    , m_ok(false)
+{
+}
+
+DocumentIO::~DocumentIO() {
+    if (m_thread) {
+        // A half-read document is useless, a half-written file is not
+        // worth losing the save for
+        if (m_job != Save) m_cancelled.storeRelease(1);
+        m_thread->disconnect(this);
+        m_thread->wait();
+        delete m_thread;
+    }
+    discardLoaded();
+}
+
+bool DocumentIO::startSave(OcafDocument& document, const QString& filename) {
+    if (m_thread) return false;
+    discardLoaded();
+
+    m_app = OcafDocument::createApplication();
+    m_doc = document.snapshot(m_app);
+    if (m_doc.IsNull()) {
+        m_app.Nullify();
+        return false;
+    }
+
+    m_filename = filename;
+    run(Save);
+    return true;
+}
+
+bool DocumentIO::startLoad(const QString& filename, LoadMode mode) {
+    if (m_thread || !QFile::exists(filename)) return false;
+    discardLoaded();
+
+    m_app = OcafDocument::createApplication();
+    m_filename = filename;
+    m_mode = mode;
+    run(Load);
+    return true;
+}
+
+bool DocumentIO::startExport(OcafDocument& document, const QString& filename, ShapeExporter::Format format) {
+    if (m_thread) return false;
+    discardLoaded();
+
+    // Dirty features are rebuilt here, on the document's thread; the
+    // worker only sees the copies
+    m_parts = ShapeExporter().collect(document, &m_missing);
+    ShapeExporter::detach(m_parts);
+
+    m_filename = filename;
+    m_format = format;
+    run(Export);
+    return true;
+}
+
+void DocumentIO::cancel() {
+    if (m_thread) m_cancelled.storeRelease(1);
+}
+
+void DocumentIO::run(Job job) {
+    m_cancelled.storeRelease(0);
+    m_job = job;
+    m_ok = false;
+
+    m_thread = QThread::create([this]() {
+        Handle(JobProgress) indicator = new JobProgress(this, &m_cancelled);
+
+        if (m_job == Export) {
+            m_ok = ShapeExporter::write(m_parts, m_filename, m_format, QString(), indicator->Start()).ok;
+        } else if (m_job == Save) {
+            QString partial = PartialFile::path(m_filename);
+            TCollection_ExtendedString partialName(partial.toStdWString().c_str());
+            m_ok = m_app->SaveAs(m_doc, partialName, indicator->Start()) == PCDM_SS_OK;
+            if (m_ok) {
+                m_ok = PartialFile::commit(m_filename);
+            } else {
+                PartialFile::discard(m_filename);
+            }
+
+            m_app->Close(m_doc);
+            m_doc.Nullify();
+            m_app.Nullify();
+        } else {
+            TCollection_ExtendedString path(m_filename.toStdWString().c_str());
+            m_ok = m_app->Open(path, m_doc, OcafDocument::readerFilter(m_mode),
+                               indicator->Start()) == PCDM_RS_OK;
+            if (!m_ok) m_doc.Nullify();
+        }
+    });
+
+    connect(m_thread, &QThread::finished, this, [this]() {
+        m_thread->deleteLater();
+        m_thread = nullptr;
+        if (m_job == Export) {
+            int parts = m_parts.size();
+            m_parts.clear();
+            Q_EMIT exportFinished(m_ok, m_filename, parts, m_missing);
+        } else if (m_job == Save) {
+            Q_EMIT saveFinished(m_ok, m_filename);
+        } else {
+            if (!m_ok) discardLoaded();
+            Q_EMIT loadFinished(m_ok, m_filename);
+        }
+    });
+    m_thread->start();
+}
+
+bool DocumentIO::takeLoaded(OcafDocument& document) {
+    if (m_thread || m_doc.IsNull()) return false;
+
+    bool ok = document.adoptDocument(m_app, m_doc, m_filename, m_mode);
+    m_doc.Nullify();
+    m_app.Nullify();
+    return ok;
+}
+
+void DocumentIO::discardLoaded() {
+    if (!m_doc.IsNull()) m_app->Close(m_doc);
+    m_doc.Nullify();
+    m_app.Nullify();
+}
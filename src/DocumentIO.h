@@ -0,0 +1,80 @@
+#ifndef DOCUMENTIO_H
+#define DOCUMENTIO_H
+
+#include <TDocStd_Application.hxx>
+#include <TDocStd_Document.hxx>
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QString>
+
+#include "OcafDocument.h"
+#include "ShapeExporter.h"
+
+class QThread;
+
+// Saves, loads and exports documents on a worker thread so the window
+// stays responsive. A save writes a snapshot of the document taken when
+// it starts, so editing can go on meanwhile; an export does the same
+// with detached copies of the part shapes. A load reads into a separate
+// document that replaces the current one only when takeLoaded is called.
+// Progress comes from OCCT's Message_ProgressRange; cancel() stops the
+// reader or writer at its next progress check. Only one job runs at a
+// time.
+class DocumentIO : public QObject {
+    Q_OBJECT
+
+public:
+    explicit DocumentIO(QObject* parent = nullptr);
+    // Waits for a running save; a running load is cancelled
+    ~DocumentIO();
+
+    // Snapshots document on the calling thread, then writes it. The file
+    // is written next to filename first and replaces it only when
+    // complete, so a cancelled or failed save leaves the old file intact.
+    bool startSave(OcafDocument& document, const QString& filename);
+    bool startLoad(const QString& filename, LoadMode mode);
+    // Collects the parts on the calling thread, then writes them like
+    // ShapeExporter::write
+    bool startExport(OcafDocument& document, const QString& filename, ShapeExporter::Format format);
+    void cancel();
+    bool isBusy() const { return m_thread != nullptr; }
+
+    // Hands the document of a finished load over to document
+    bool takeLoaded(OcafDocument& document);
+
+Q_SIGNALS:
+    // Percent done of the running job
+    void progress(int percent);
+    void saveFinished(bool ok, const QString& filename);
+    // ok is false on failure and on cancellation
+    void loadFinished(bool ok, const QString& filename);
+    // missing counts the extrudes left out for lack of a shape
+    void exportFinished(bool ok, const QString& filename, int parts, int missing);
+
+private:
+    enum Job {
+        Save,
+        Load,
+        Export
+    };
+
+    void run(Job job);
+    void discardLoaded();
+
+    QThread* m_thread;
+    QAtomicInt m_cancelled;
+
+    // Job state; the worker owns it until the thread finishes
+    Handle(TDocStd_Application) m_app;
+    Handle(TDocStd_Document) m_doc;
+    QString m_filename;
+    LoadMode m_mode;
+    QVector<ShapeExporter::Part> m_parts;
+    ShapeExporter::Format m_format;
+    int m_missing;
+    Job m_job;
+    bool m_ok;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include "EditJournal.h"
+#include "PartialFile.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    const char kMagic[8] = { 'A', 'I', 'C', 'A', 'D', 'J', 'N', 'L' };
+    const quint32 kVersion = 1;
+    // Magic, version, base size, base time
+    const qint64 kHeaderSize = 8 + 4 + 8 + 8;
+    // Record framing: payload size, type, checksum
+    const qint64 kFrameSize = 4 + 1 + 4;
+    // Buffered records are written out early past this size, but only
+    // synced at the end of the command
+    const int kWriteThreshold = 1 << 20;
+
+    // FNV-1a; only has to catch records torn by a crash
+    quint32 checksum(quint8 type, const char* data, qint64 size) {
+        quint32 hash = 2166136261u;
+        hash = (hash ^ type) * 16777619u;
+        for (qint64 i = 0; i < size; ++i) {
+            hash = (hash ^ quint8(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    bool syncToDisk(QFile& file) {
+        if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return ::fsync(file.handle()) == 0;
+#endif
+    }
+
+    QByteArray header(const EditJournal::Base& base) {
+        QByteArray bytes;
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        out.writeRawData(kMagic, sizeof(kMagic));
+        out << kVersion << base.size << base.modified;
+        return bytes;
+    }
+
+    void writePlane(QDataStream& out, const CustomPlane& plane) {
+        const QVector3D* vectors[4] = { &plane.origin, &plane.normal, &plane.uAxis, &plane.vAxis };
+        for (const QVector3D* v : vectors) {
+            out << double(v->x()) << double(v->y()) << double(v->z());
+        }
+    }
+
+    void readPlane(QDataStream& in, CustomPlane& plane) {
+        QVector3D* vectors[4] = { &plane.origin, &plane.normal, &plane.uAxis, &plane.vAxis };
+        for (QVector3D* v : vectors) {
+            double x, y, z;
+            in >> x >> y >> z;
+            *v = QVector3D(x, y, z);
+        }
+    }
+
+    bool decode(quint8 type, const QByteArray& payload, EditJournal::Entry& entry) {
+        if (type < EditJournal::OpenCommand || type > EditJournal::AddPolylines) return false;
+
+        entry.type = EditJournal::RecordType(type);
+        entry.featureId = -1;
+        entry.sketchId = -1;
+        entry.height = 0.0;
+
+        QDataStream in(payload);
+        switch (entry.type) {
+        case EditJournal::CreateSketch:
+            in >> entry.featureId >> entry.name;
+            readPlane(in, entry.plane);
+            break;
+        case EditJournal::AddPolyline: {
+            quint32 numPoints = 0;
+            in >> entry.featureId >> numPoints;
+            if (qint64(numPoints) * 16 > payload.size()) return false;
+            entry.xy.resize(2 * numPoints);
+            for (double& c : entry.xy) in >> c;
+            break;
+        }
+        case EditJournal::CreateExtrude:
+            in >> entry.featureId >> entry.sketchId >> entry.height >> entry.name;
+            break;
+        case EditJournal::SetName:
+            in >> entry.featureId >> entry.name;
+            break;
+        case EditJournal::AddPolylines: {
+            quint32 numOffsets = 0;
+            quint32 numCoords = 0;
+            in >> entry.featureId >> numOffsets;
+            if (qint64(numOffsets) * 4 > payload.size()) return false;
+            entry.offsets.resize(numOffsets);
+            for (int& offset : entry.offsets) in >> offset;
+            in >> numCoords;
+            if (qint64(numCoords) * 8 > payload.size()) return false;
+            entry.xy.resize(numCoords);
+            for (double& c : entry.xy) in >> c;
+            break;
+        }
+        default:
+            break;
+        }
+        return in.status() == QDataStream::Ok;
+    }
+}
+
+EditJournal::EditJournal() : m_written(0) {
+}
+
+EditJournal::~EditJournal() {
+    close();
+}
+
+EditJournal::Base EditJournal::baseOf(const QString& documentPath) {
+    Base base;
+    base.size = -1;
+    base.modified = 0;
+
+    QFileInfo info(documentPath);
+    if (!documentPath.isEmpty() && info.exists()) {
+        base.size = info.size();
+        base.modified = info.lastModified().toMSecsSinceEpoch();
+    }
+    return base;
+}
+
+bool EditJournal::read(const QString& path, const Base& base, QVector<Entry>& entries,
+                       qint64* validSize) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray bytes = file.readAll();
+    if (bytes.size() < kHeaderSize || !bytes.startsWith(QByteArray(kMagic, sizeof(kMagic)))) {
+        return false;
+    }
+
+    QDataStream in(bytes);
+    in.skipRawData(sizeof(kMagic));
+    quint32 version = 0;
+    Base stored;
+    in >> version >> stored.size >> stored.modified;
+    if (version != kVersion || !(stored == base)) return false;
+
+    qint64 offset = kHeaderSize;
+    while (bytes.size() - offset >= kFrameSize) {
+        quint32 size = 0;
+        quint8 type = 0;
+        in >> size >> type;
+        if (qint64(size) > bytes.size() - offset - kFrameSize) break;
+
+        const char* payload = bytes.constData() + offset + 5;
+        in.skipRawData(size);
+        quint32 sum = 0;
+        in >> sum;
+        if (sum != checksum(type, payload, size)) break;
+
+        Entry entry;
+        if (!decode(type, QByteArray::fromRawData(payload, size), entry)) break;
+        entries.append(entry);
+        offset += kFrameSize + size;
+    }
+
+    if (validSize) *validSize = offset;
+    return true;
+}
+
+bool EditJournal::open(const QString& path, const Base& base, bool keep) {
+    close();
+
+    QVector<Entry> entries;
+    qint64 validSize = 0;
+    bool reuse = keep && read(path, base, entries, &validSize);
+
+    m_file.setFileName(path);
+    QIODevice::OpenMode mode = QIODevice::ReadWrite;
+    if (!reuse) mode |= QIODevice::Truncate;
+    if (!m_file.open(mode)) {
+        qWarning() << "Cannot open edit journal" << path;
+        return false;
+    }
+
+    if (reuse) {
+        // Drops a record torn by the crash, if any
+        m_file.resize(validSize);
+        m_file.seek(validSize);
+        m_written = validSize;
+        return true;
+    }
+
+    m_written = 0;
+    m_pending = header(base);
+    return sync();
+}
+
+void EditJournal::close() {
+    if (!m_file.isOpen()) return;
+    sync();
+    m_file.close();
+    m_written = 0;
+    m_pending.clear();
+}
+
+bool EditJournal::rebase(const QString& path, const Base& base, qint64 position) {
+    if (!isOpen() || !writePending()) return false;
+
+    // Records logged after position are not in the new base yet
+    m_file.seek(qBound(kHeaderSize, position, m_written));
+    QByteArray tail = m_file.readAll();
+    QString oldPath = m_file.fileName();
+    m_file.close();
+    m_written = 0;
+
+    // Written aside and committed over path in one atomic replace, so a
+    // crash leaves either journal intact
+    QFile out(PartialFile::path(path));
+    bool ok = out.open(QIODevice::WriteOnly | QIODevice::Truncate)
+              && out.write(header(base)) == kHeaderSize && out.write(tail) == tail.size();
+    out.close();
+    if (ok) {
+        ok = PartialFile::commit(path);
+    } else {
+        PartialFile::discard(path);
+    }
+    if (!ok) {
+        qWarning() << "Cannot move edit journal to" << path;
+        return false;
+    }
+    if (oldPath != path) QFile::remove(oldPath);
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) return false;
+    m_written = m_file.size();
+    m_file.seek(m_written);
+    return true;
+}
+
+void EditJournal::append(RecordType type, const QByteArray& payload) {
+    if (!isOpen()) return;
+
+    QByteArray record;
+    record.reserve(kFrameSize + payload.size());
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out << quint32(payload.size()) << quint8(type);
+    out.writeRawData(payload.constData(), payload.size());
+    out << checksum(quint8(type), payload.constData(), payload.size());
+    m_pending += record;
+
+    if (m_pending.size() >= kWriteThreshold) writePending();
+}
+
+bool EditJournal::writePending() {
+    if (m_pending.isEmpty()) return true;
+    if (m_file.write(m_pending) != m_pending.size()) {
+        qWarning() << "Cannot write edit journal" << m_file.fileName();
+        return false;
+    }
+    m_written += m_pending.size();
+    m_pending.clear();
+    return true;
+}
+
+bool EditJournal::sync() {
+    if (!isOpen()) return false;
+    return writePending() && syncToDisk(m_file);
+}
+
+void EditJournal::logCommand(RecordType type) {
+    append(type, QByteArray());
+}
+
+void EditJournal::logCreateSketch(int featureId, const CustomPlane& plane, const QString& name) {
+    if (!isOpen()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << featureId << name;
+    writePlane(out, plane);
+    append(CreateSketch, payload);
+}
+
+void EditJournal::logAddPolyline(int sketchId, const double* xy, int numPoints) {
+    if (!isOpen()) return;
+    QByteArray payload;
+    payload.reserve(8 + 16 * numPoints);
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << sketchId << quint32(numPoints);
+    for (int i = 0; i < 2 * numPoints; ++i) out << xy[i];
+    append(AddPolyline, payload);
+}
+
+void EditJournal::logCreateExtrude(int featureId, int sketchId, double height, const QString& name) {
+    if (!isOpen()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << featureId << sketchId << height << name;
+    append(CreateExtrude, payload);
+}
+
+void EditJournal::logSetName(int featureId, const QString& name) {
+    if (!isOpen()) return;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << featureId << name;
+    append(SetName, payload);
+}
+
+void EditJournal::logAddPolylines(int sketchId, const SketchPolylineSet& polylines) {
+    if (!isOpen()) return;
+    QByteArray payload;
+    payload.reserve(12 + 4 * polylines.offsets.size() + 8 * polylines.coords.size());
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << sketchId << quint32(polylines.offsets.size());
+    for (int offset : polylines.offsets) out << offset;
+    out << quint32(polylines.coords.size());
+    for (double c : polylines.coords) out << c;
+    append(AddPolylines, payload);
+}
@@ -0,0 +1,99 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "CustomPlane.h"
+#include "SketchPolyline.h"
+
+// Append-only log of the document edits made since the last full save.
+// Every record is framed with its size and a checksum, so a record torn
+// by a crash ends the log instead of corrupting it. Records are buffered
+// and written and synced to disk together by sync(), which the document
+// calls once per committed, aborted, undone or redone command. The
+// header identifies the save the edits apply to by its size and time.
+class EditJournal {
+public:
+    enum RecordType {
+        OpenCommand = 1,
+        CommitCommand,
+        AbortCommand,
+        Undo,
+        Redo,
+        CreateSketch,
+        AddPolyline,
+        CreateExtrude,
+        SetName,
+        AddPolylines
+    };
+
+    // The full save a journal applies to; a null path means a new,
+    // never saved document
+    struct Base {
+        qint64 size;
+        qint64 modified;
+
+        bool operator==(const Base& other) const {
+            return size == other.size && modified == other.modified;
+        }
+    };
+
+    struct Entry {
+        RecordType type;
+        int featureId;     // created, renamed or extended feature
+        int sketchId;      // CreateExtrude
+        QString name;
+        CustomPlane plane;
+        double height;
+        QVector<double> xy;
+        // AddPolylines: point offsets of the polylines in xy
+        QVector<int> offsets;
+    };
+
+    EditJournal();
+    ~EditJournal();
+
+    static Base baseOf(const QString& documentPath);
+
+    // Reads the intact records of the journal at path. Returns false when
+    // there is no journal or it belongs to another base.
+    static bool read(const QString& path, const Base& base, QVector<Entry>& entries,
+                     qint64* validSize = nullptr);
+
+    // Starts logging to path. With keep, intact records of a journal for
+    // the same base are kept and new ones appended after them.
+    bool open(const QString& path, const Base& base, bool keep);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+
+    // Logical size including buffered records, for rebase
+    qint64 position() const { return m_written + m_pending.size(); }
+
+    // Moves the log to path for a new base, keeping only the records
+    // logged after position
+    bool rebase(const QString& path, const Base& base, qint64 position);
+
+    void logCommand(RecordType type);
+    void logCreateSketch(int featureId, const CustomPlane& plane, const QString& name);
+    void logAddPolyline(int sketchId, const double* xy, int numPoints);
+    void logCreateExtrude(int featureId, int sketchId, double height, const QString& name);
+    void logSetName(int featureId, const QString& name);
+    void logAddPolylines(int sketchId, const SketchPolylineSet& polylines);
+
+    // Writes buffered records and waits until they are on disk
+    bool sync();
+
+private:
+    void append(RecordType type, const QByteArray& payload);
+    bool writePending();
+
+    QFile m_file;
+    qint64 m_written;
+    QByteArray m_pending;
+};
+
+#endif
@@ -0,0 +1,320 @@
+#include "EntityImporter.h"
+#include "OcafDocument.h"
+#include "SketchFile.h"
+
+#include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+    struct Chunk {
+        const char* begin;
+        const char* end;
+        EntityImporter::Parsed parsed;
+    };
+
+    struct ParseFunctor {
+        QVector<Chunk>* chunks;
+
+        void operator()(int threadIndex, int index) const {
+            (void)threadIndex;
+            Chunk& chunk = (*chunks)[index];
+            EntityImporter::parse(chunk.begin, chunk.end, chunk.parsed);
+        }
+    };
+
+    // Gives the polylines of a chunk the shape one serial parse would
+    // have made. chain holds the LINE chain that ended the previous chunk:
+    // it goes in front, extended by the first polyline when that chain
+    // continues there. A chain ending this chunk is moved to chain, as
+    // the next chunk may continue it.
+    void joinChains(EntityImporter::Parsed& parsed, QVector<double>& chain) {
+        SketchPolylineSet& polylines = parsed.polylines;
+        int count = polylines.polylineCount();
+        bool chainEnds = count > 0 ? parsed.endsWithLine : !chain.isEmpty();
+
+        if (!chain.isEmpty()) {
+            SketchPolylineSet joined;
+            joined.coords.reserve(chain.size() + polylines.coords.size());
+            joined.append(chain.constData(), chain.size() / 2);
+
+            int first = 0;
+            if (parsed.startsWithLine && polylines.coords.at(0) == chain.at(chain.size() - 2)
+                && polylines.coords.at(1) == chain.last()) {
+                SketchPolylineView head = polylines.polyline(0);
+                int at = joined.coords.size();
+                joined.coords.resize(at + 2 * (head.pointCount - 1));
+                std::copy(head.xy + 2, head.xy + 2 * head.pointCount, joined.coords.data() + at);
+                joined.offsets.last() += head.pointCount - 1;
+                first = 1;
+            }
+            for (int k = first; k < count; ++k) {
+                SketchPolylineView view = polylines.polyline(k);
+                joined.append(view.xy, view.pointCount);
+            }
+            polylines = joined;
+            chain.clear();
+        }
+
+        if (chainEnds) {
+            int last = polylines.polylineCount() - 1;
+            int start = polylines.offsets.at(last);
+            chain = polylines.coords.mid(2 * start);
+            polylines.coords.resize(2 * start);
+            polylines.offsets.removeLast();
+            if (polylines.offsets.size() == 1) polylines.offsets.clear();
+        }
+    }
+
+    inline bool isBlank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipBlanks(const char* p, const char* end) {
+        while (p < end && isBlank(*p)) ++p;
+        return p;
+    }
+
+    // Reads count numbers separated by blanks; the rest of the line must
+    // be blank too
+    bool parseNumbers(const char* p, const char* end, double* values, int count) {
+        for (int i = 0; i < count; ++i) {
+            p = skipBlanks(p, end);
+            std::from_chars_result parsed = std::from_chars(p, end, values[i]);
+            if (parsed.ec != std::errc()) return false;
+            p = parsed.ptr;
+        }
+        return skipBlanks(p, end) == end;
+    }
+
+    inline bool startsWithKeyword(const char* p, const char* end, const char* keyword, int length) {
+        return end - p > length && std::memcmp(p, keyword, length) == 0 && isBlank(p[length]);
+    }
+}
+
+EntityImporter::EntityImporter()
+    : m_threadCount(0)
+    , m_chunkSize(4 << 20)
+{
+}
+
+void EntityImporter::parse(const char* begin, const char* end, Parsed& parsed) {
+    SketchPolylineSet& polylines = parsed.polylines;
+    qint64& entities = parsed.entities;
+    qint64& lines = parsed.lines;
+    qint64& skipped = parsed.skipped;
+    qint64& firstSkippedLine = parsed.firstSkippedLine;
+    entities = 0;
+    lines = 0;
+    skipped = 0;
+    firstSkippedLine = 0;
+    parsed.startsWithLine = false;
+    // Whether the last polyline came from LINEs and may be extended
+    bool chainOpen = false;
+
+    const char* p = begin;
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        ++lines;
+
+        const char* token = skipBlanks(p, eol);
+        p = eol + 1;
+        if (token == eol) continue;
+
+        double v[5];
+        if (startsWithKeyword(token, eol, "LINE", 4) && parseNumbers(token + 4, eol, v, 4)) {
+            if (entities == 0) parsed.startsWithLine = true;
+            polylines.appendSegment(v, chainOpen);
+            chainOpen = true;
+            ++entities;
+        } else if (startsWithKeyword(token, eol, "ARC", 3) && parseNumbers(token + 3, eol, v, 5)) {
+            polylines.appendArc(v[0], v[1], v[2], v[3], v[4]);
+            chainOpen = false;
+            ++entities;
+        } else {
+            if (skipped++ == 0) firstSkippedLine = lines;
+        }
+    }
+    parsed.endsWithLine = chainOpen;
+}
+
+EntityImporter::Result EntityImporter::import(const QString& path, OcafDocument& document,
+                                              TDF_Label sketchLabel) const {
+    Result result;
+    result.ok = false;
+    result.entities = 0;
+    result.skipped = 0;
+    result.firstSkippedLine = 0;
+    result.polylines = 0;
+    result.points = 0;
+    result.milliseconds = 0.0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(path);
+    if (sketchLabel.IsNull() || !file.open(QIODevice::ReadOnly)) {
+        result.error = "Cannot open " + path;
+        return result;
+    }
+
+    // Appending needs what the sketch already holds in its file
+    if (!document.materialize(QVector<TDF_Label>() << sketchLabel)) {
+        result.error = "Cannot read the stored geometry of the sketch";
+        return result;
+    }
+
+    int threads = m_threadCount > 0 ? m_threadCount : qMax(1, OSD_Parallel::NbLogicalProcessors());
+    qint64 blockSize = qint64(qMax(1, m_chunkSize)) * threads;
+
+    document.beginBatch();
+
+    QByteArray carry;
+    qint64 lineBase = 0;
+    // LINE chain at the end of the last chunk, held back until the next
+    // chunk shows whether it goes on
+    QVector<double> chain;
+    for (;;) {
+        QByteArray data = file.read(blockSize);
+        bool atEnd = data.isEmpty() || file.atEnd();
+        QByteArray block = carry + data;
+        if (block.isEmpty()) break;
+
+        // A partial last line waits for the next block
+        int usable = block.size();
+        carry.clear();
+        if (!atEnd) {
+            int lastNewline = block.lastIndexOf('\n');
+            if (lastNewline < 0) {
+                carry = block;
+                continue;
+            }
+            usable = lastNewline + 1;
+            carry = block.mid(usable);
+        }
+
+        // One chunk per thread, cut at line ends
+        QVector<Chunk> chunks;
+        const char* begin = block.constData();
+        const char* stop = begin + usable;
+        qint64 target = (usable + threads - 1) / threads;
+        while (begin < stop) {
+            const char* cut = stop;
+            if (stop - begin > target) {
+                const char* newline = static_cast<const char*>(std::memchr(begin + target, '\n', stop - begin - target));
+                if (newline) cut = newline + 1;
+            }
+            Chunk chunk;
+            chunk.begin = begin;
+            chunk.end = cut;
+            chunks.append(chunk);
+            begin = cut;
+        }
+
+        ParseFunctor functor;
+        functor.chunks = &chunks;
+        if (chunks.size() == 1) {
+            functor(0, 0);
+        } else {
+            OSD_ThreadPool::Launcher launcher(*OSD_ThreadPool::DefaultPool(), chunks.size());
+            launcher.Perform(0, chunks.size(), functor);
+        }
+
+        // In file order, one bulk append per chunk
+        for (Chunk& chunk : chunks) {
+            Parsed& parsed = chunk.parsed;
+            joinChains(parsed, chain);
+            document.addPolylinesToSketch(sketchLabel, parsed.polylines);
+            result.entities += parsed.entities;
+            result.skipped += parsed.skipped;
+            result.polylines += parsed.polylines.polylineCount();
+            result.points += parsed.polylines.pointCount();
+            if (parsed.skipped > 0 && result.firstSkippedLine == 0) {
+                result.firstSkippedLine = lineBase + parsed.firstSkippedLine;
+            }
+            lineBase += parsed.lines;
+        }
+
+        if (atEnd) break;
+    }
+
+    if (!chain.isEmpty()) {
+        SketchPolylineSet last;
+        last.append(chain.constData(), chain.size() / 2);
+        document.addPolylinesToSketch(sketchLabel, last);
+        result.polylines += 1;
+        result.points += last.pointCount();
+    }
+
+    document.endBatch();
+
+    result.ok = true;
+    result.milliseconds = timer.nsecsElapsed() / 1.0e6;
+    return result;
+}
+
+QString EntityImporter::benchmark(int entities) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) return "Cannot create a temporary directory\n";
+    QString path = dir.filePath("drawing.txt");
+
+    // Chains of four connected lines closed off by an arc, written the
+    // way LineEntity::save and ArcEntity::save did
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return "Cannot write " + path + "\n";
+        QTextStream out(&file);
+        for (int i = 0; i < entities; ++i) {
+            double x = (i / 5 % 1000) * 50.0 + (i % 5) * 7.5;
+            double y = (i / 5000) * 20.0;
+            if (i % 5 == 4) {
+                out << "ARC " << x << " " << y << " " << 4.5 << " " << 0.25 << " " << 2.5 << "\n";
+            } else {
+                out << "LINE " << x << " " << y << " " << x + 7.5 << " " << y << "\n";
+            }
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    SketchFile::Contents contents;
+    QString error;
+    if (!SketchFile::readLegacyText(path, contents, &error)) return error + "\n";
+    double textMs = timer.nsecsElapsed() / 1.0e6;
+
+    QString report = QString("Import of %1 LINE/ARC entities\n"
+                             "QTextStream: time=%2 ms\n").arg(entities).arg(textMs, 0, 'f', 1);
+
+    int cores = qMax(1, OSD_Parallel::NbLogicalProcessors());
+    QVector<int> threadCounts;
+    threadCounts << 1;
+    if (cores > 1) threadCounts << cores;
+
+    for (int threads : threadCounts) {
+        OcafDocument doc;
+        doc.newDocument();
+        TDF_Label sketch = doc.createSketch(CustomPlane::XY(), "Drawing");
+
+        EntityImporter importer;
+        importer.setThreadCount(threads);
+        Result result = importer.import(path, doc, sketch);
+        if (!result.ok) return report + result.error + "\n";
+
+        report += QString("threads=%1 time=%2 ms speedup=%3x polylines=%4 points=%5\n")
+                      .arg(threads)
+                      .arg(result.milliseconds, 0, 'f', 1)
+                      .arg(result.milliseconds > 0.0 ? textMs / result.milliseconds : 0.0, 0, 'f', 1)
+                      .arg(result.polylines)
+                      .arg(result.points);
+    }
+    return report;
+}
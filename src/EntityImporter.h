@@ -0,0 +1,75 @@
+#ifndef ENTITYIMPORTER_H
+#define ENTITYIMPORTER_H
+
+#include <TDF_Label.hxx>
+
+#include <QString>
+
+#include "SketchPolyline.h"
+
+class OcafDocument;
+
+// Streaming reader for the legacy LINE/ARC text format:
+//
+//   LINE x1 y1 x2 y2
+//   ARC cx cy radius start sweep     (radians, sweep signed)
+//
+// The file is read in large blocks; each block is split at line ends
+// into one chunk per thread and the chunks are parsed in parallel with
+// std::from_chars, which neither allocates per token nor depends on the
+// locale. Every chunk becomes one SketchPolylineSet that is appended to
+// the sketch in a single call, in file order. A LINE starting where the
+// previous LINE ended extends its polyline, also across chunks, so the
+// sketch does not depend on how the file was split; arcs are flattened.
+// Unknown or malformed lines are skipped and counted.
+class EntityImporter {
+public:
+    // What parse makes of one chunk of whole lines
+    struct Parsed {
+        SketchPolylineSet polylines;
+        qint64 entities;
+        qint64 lines;
+        qint64 skipped;
+        // 1-based line within the chunk of the first skipped line, 0 when none
+        qint64 firstSkippedLine;
+        // Whether the first and the last polyline are chains of LINEs,
+        // which import joins with the neighbouring chunks
+        bool startsWithLine;
+        bool endsWithLine;
+    };
+
+    struct Result {
+        bool ok;
+        qint64 entities;
+        qint64 skipped;
+        // 1-based line of the first skipped line, 0 when none
+        qint64 firstSkippedLine;
+        int polylines;
+        qint64 points;
+        double milliseconds;
+        QString error;
+    };
+
+    EntityImporter();
+
+    // 0 uses every core
+    void setThreadCount(int threads) { m_threadCount = threads; }
+    // Bytes parsed by one thread per block
+    void setChunkSize(int bytes) { m_chunkSize = bytes; }
+
+    // Appends every entity of the file to sketchLabel
+    Result import(const QString& path, OcafDocument& document, TDF_Label sketchLabel) const;
+
+    // Parses one chunk of whole lines into polylines
+    static void parse(const char* begin, const char* end, Parsed& parsed);
+
+    // Writes the given number of entities as text and times the
+    // QTextStream reader against this importer at 1 and all threads
+    static QString benchmark(int entities);
+
+private:
+    int m_threadCount;
+    int m_chunkSize;
+};
+
+#endif
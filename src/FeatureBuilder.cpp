@@ -0,0 +1,163 @@
+#include "FeatureBuilder.h"
+
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepPrimAPI_MakePrism.hxx>
+#include <TopoDS.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Vec.hxx>
+#include <Precision.hxx>
+#include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+
+#include <QElapsedTimer>
+
+#include <cmath>
+
+TopoDS_Shape FeatureBuilder::makePolyline(const SketchPolylineView& points, const CustomPlane& plane) {
+    if (points.pointCount < 2) return TopoDS_Shape();
+
+    try {
+        BRepBuilderAPI_MakeWire wireBuilder;
+
+        for (int i = 0; i < points.pointCount - 1; ++i) {
+            gp_Pnt gp1 = plane.toWorld(points.x(i), points.y(i));
+            gp_Pnt gp2 = plane.toWorld(points.x(i + 1), points.y(i + 1));
+
+            if (gp1.Distance(gp2) > Precision::Confusion()) {
+                BRepBuilderAPI_MakeEdge edgeBuilder(gp1, gp2);
+                if (edgeBuilder.IsDone()) {
+                    wireBuilder.Add(edgeBuilder.Edge());
+                }
+            }
+        }
+
+        if (wireBuilder.IsDone()) {
+            return wireBuilder.Wire();
+        }
+    } catch (...) {
+    }
+
+    return TopoDS_Shape();
+}
+
+TopoDS_Shape FeatureBuilder::makeExtrude(const SketchPolylineSet& polylines,
+                                         const CustomPlane& plane, double height) {
+    if (polylines.polylineCount() == 0) return TopoDS_Shape();
+
+    SketchPolylineView points = polylines.polyline(0);
+    if (points.pointCount < 3) return TopoDS_Shape();
+
+    try {
+        BRepBuilderAPI_MakeWire wireBuilder;
+
+        for (int i = 0; i < points.pointCount; ++i) {
+            int next = (i + 1) % points.pointCount;
+
+            gp_Pnt gp1 = plane.toWorld(points.x(i), points.y(i));
+            gp_Pnt gp2 = plane.toWorld(points.x(next), points.y(next));
+
+            if (gp1.Distance(gp2) > Precision::Confusion()) {
+                BRepBuilderAPI_MakeEdge edgeBuilder(gp1, gp2);
+                if (edgeBuilder.IsDone()) {
+                    wireBuilder.Add(edgeBuilder.Edge());
+                }
+            }
+        }
+
+        if (!wireBuilder.IsDone()) return TopoDS_Shape();
+
+        TopoDS_Wire wire = wireBuilder.Wire();
+
+        gp_Pln gpPlane = plane.toGpPln();
+        BRepBuilderAPI_MakeFace faceBuilder(gpPlane, wire);
+
+        if (!faceBuilder.IsDone()) return TopoDS_Shape();
+
+        TopoDS_Face face = faceBuilder.Face();
+
+        gp_Vec extrudeVec(plane.normal.x() * height,
+                          plane.normal.y() * height,
+                          plane.normal.z() * height);
+
+        BRepPrimAPI_MakePrism prismBuilder(face, extrudeVec);
+
+        if (prismBuilder.IsDone()) {
+            return prismBuilder.Shape();
+        }
+    } catch (...) {
+    }
+
+    return TopoDS_Shape();
+}
+
+namespace {
+    struct BenchmarkInput {
+        SketchPolylineSet polylines;
+        double height;
+        TopoDS_Shape result;
+    };
+
+    struct BenchmarkFunctor {
+        QVector<BenchmarkInput>* inputs;
+        CustomPlane plane;
+
+        void operator()(int threadIndex, int index) const {
+            (void)threadIndex;
+            BenchmarkInput& input = (*inputs)[index];
+            input.result = FeatureBuilder::makeExtrude(input.polylines, plane, input.height);
+        }
+    };
+}
+
+QString FeatureBuilder::benchmark(int shapes, int threads) {
+    // 32-sided prisms: enough edges for wire and face construction to
+    // dominate over per-call overhead
+    const int sides = 32;
+
+    QVector<BenchmarkInput> inputs(shapes);
+    double outline[2 * (sides + 1)];
+    for (int i = 0; i < shapes; ++i) {
+        double cx = (i % 100) * 30.0;
+        double cy = (i / 100) * 30.0;
+        for (int k = 0; k <= sides; ++k) {
+            double a = 2.0 * M_PI * (k % sides) / sides;
+            outline[2 * k] = cx + 10.0 * std::cos(a);
+            outline[2 * k + 1] = cy + 10.0 * std::sin(a);
+        }
+        inputs[i].polylines.append(outline, sides + 1);
+        inputs[i].height = 5.0 + (i % 5);
+    }
+
+    BenchmarkFunctor functor;
+    functor.inputs = &inputs;
+    functor.plane = CustomPlane::XY();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < shapes; ++i) functor(0, i);
+    double serialMs = timer.nsecsElapsed() / 1.0e6;
+
+    if (threads <= 0) threads = OSD_Parallel::NbLogicalProcessors();
+    Handle(OSD_ThreadPool) pool = new OSD_ThreadPool(threads);
+    timer.restart();
+    OSD_ThreadPool::Launcher launcher(*pool, threads);
+    launcher.Perform(0, shapes, functor);
+    double parallelMs = timer.nsecsElapsed() / 1.0e6;
+
+    int failed = 0;
+    for (const BenchmarkInput& input : inputs) {
+        if (input.result.IsNull()) ++failed;
+    }
+
+    return QString("FeatureBuilder: %1 extrudes of %2 sides\n"
+                   "serial:    %3 ms (%4 shapes/s)\n"
+                   "%5 threads: %6 ms (%7 shapes/s)\n"
+                   "failed: %8\n")
+        .arg(shapes).arg(sides)
+        .arg(serialMs, 0, 'f', 1).arg(serialMs > 0.0 ? shapes * 1000.0 / serialMs : 0.0, 0, 'f', 0)
+        .arg(threads)
+        .arg(parallelMs, 0, 'f', 1).arg(parallelMs > 0.0 ? shapes * 1000.0 / parallelMs : 0.0, 0, 'f', 0)
+        .arg(failed);
+}
@@ -0,0 +1,28 @@
+#ifndef FEATUREBUILDER_H
+#define FEATUREBUILDER_H
+
+#include <TopoDS_Shape.hxx>
+
+#include <QString>
+#include <QVector>
+
+#include "CustomPlane.h"
+#include "SketchPolyline.h"
+
+// View-independent shape construction for sketch and extrude features.
+//
+// Keeps no state and touches nothing but its arguments, so any number of
+// calls may run concurrently. Building from document labels is
+// Regenerator's job.
+class FeatureBuilder {
+public:
+    static TopoDS_Shape makePolyline(const SketchPolylineView& points, const CustomPlane& plane);
+    static TopoDS_Shape makeExtrude(const SketchPolylineSet& polylines,
+                                    const CustomPlane& plane, double height);
+
+    // Builds <shapes> synthetic extrudes serially and on threads; returns
+    // a throughput report
+    static QString benchmark(int shapes, int threads);
+};
+
+#endif
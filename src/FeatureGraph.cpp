@@ -0,0 +1,95 @@
+#include "FeatureGraph.h"
+
+#include <algorithm>
+
+void FeatureGraph::clear() {
+    m_upstream.clear();
+    m_downstream.clear();
+    m_dirty.clear();
+}
+
+void FeatureGraph::addNode(int id) {
+    if (!m_upstream.contains(id)) {
+        m_upstream.insert(id, QVector<int>());
+        m_downstream.insert(id, QVector<int>());
+    }
+    m_dirty.insert(id);
+}
+
+void FeatureGraph::removeNode(int id) {
+    for (int up : m_upstream.value(id)) {
+        m_downstream[up].removeAll(id);
+    }
+    for (int down : m_downstream.value(id)) {
+        m_upstream[down].removeAll(id);
+        markDirty(down);
+    }
+    m_upstream.remove(id);
+    m_downstream.remove(id);
+    m_dirty.remove(id);
+}
+
+void FeatureGraph::addDependency(int downstream, int upstream) {
+    if (!contains(downstream) || !contains(upstream) || downstream == upstream) return;
+    if (m_upstream[downstream].contains(upstream)) return;
+
+    m_upstream[downstream].append(upstream);
+    m_downstream[upstream].append(downstream);
+    markDirty(downstream);
+}
+
+void FeatureGraph::markDirty(int id) {
+    if (!contains(id)) return;
+
+    QVector<int> stack;
+    stack.append(id);
+    while (!stack.isEmpty()) {
+        int current = stack.takeLast();
+        if (m_dirty.contains(current) && current != id) continue;
+        m_dirty.insert(current);
+        for (int down : m_downstream.value(current)) {
+            if (!m_dirty.contains(down)) stack.append(down);
+        }
+    }
+}
+
+void FeatureGraph::markAllDirty() {
+    for (auto it = m_upstream.constBegin(); it != m_upstream.constEnd(); ++it) {
+        m_dirty.insert(it.key());
+    }
+}
+
+void FeatureGraph::visitUpstream(int id, QSet<int>& visited, QVector<int>& order) const {
+    if (visited.contains(id)) return;
+    visited.insert(id);
+
+    for (int up : m_upstream.value(id)) {
+        if (m_dirty.contains(up)) visitUpstream(up, visited, order);
+    }
+    order.append(id);
+}
+
+QVector<int> FeatureGraph::dirtyInOrder() const {
+    // Sorted seeds keep the evaluation order deterministic
+    QVector<int> seeds;
+    seeds.reserve(m_dirty.size());
+    for (int id : m_dirty) seeds.append(id);
+    std::sort(seeds.begin(), seeds.end());
+
+    QSet<int> visited;
+    QVector<int> order;
+    order.reserve(seeds.size());
+    for (int id : seeds) {
+        visitUpstream(id, visited, order);
+    }
+    return order;
+}
+
+QVector<int> FeatureGraph::dirtyCone(int id) const {
+    QSet<int> visited;
+    QVector<int> order;
+    if (m_dirty.contains(id)) {
+        visitUpstream(id, visited, order);
+    }
+    return order;
+}
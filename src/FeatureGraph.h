@@ -0,0 +1,44 @@
+#ifndef FEATUREGRAPH_H
+#define FEATUREGRAPH_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+// Dependency DAG between features, keyed by feature ID.
+// An edge upstream -> downstream means the downstream feature is built
+// from the upstream one (e.g. sketch -> extrude). Dirty state always
+// covers the full downstream cone of every edited feature.
+class FeatureGraph {
+public:
+    void clear();
+
+    void addNode(int id);
+    void removeNode(int id);
+    bool contains(int id) const { return m_upstream.contains(id); }
+    void addDependency(int downstream, int upstream);
+
+    QVector<int> upstream(int id) const { return m_upstream.value(id); }
+    QVector<int> downstream(int id) const { return m_downstream.value(id); }
+
+    void markDirty(int id);
+    void markAllDirty();
+    void clearDirty(int id) { m_dirty.remove(id); }
+    bool isDirty(int id) const { return m_dirty.contains(id); }
+    bool hasDirty() const { return !m_dirty.isEmpty(); }
+    int dirtyCount() const { return m_dirty.size(); }
+
+    // Dirty features ordered so that every feature comes after its upstreams
+    QVector<int> dirtyInOrder() const;
+    // Dirty upstreams of id (transitively) plus id itself, upstream first
+    QVector<int> dirtyCone(int id) const;
+
+private:
+    void visitUpstream(int id, QSet<int>& visited, QVector<int>& order) const;
+
+    QHash<int, QVector<int>> m_upstream;
+    QHash<int, QVector<int>> m_downstream;
+    QSet<int> m_dirty;
+};
+
+#endif
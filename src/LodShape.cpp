@@ -0,0 +1,124 @@
+#include "LodShape.h"
+
+#include <BRepBndLib.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <Prs3d_Drawer.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <StdPrs_ShadedShape.hxx>
+
+#include <QtGlobal>
+
+#include <cmath>
+
+IMPLEMENT_STANDARD_RTTIEXT(LodShape, AIS_Shape)
+
+namespace {
+    // Linear deflection of each level as a fraction of the bounding box
+    // diagonal, and the matching angular deflection in radians
+    const double kLevelDeflection[LodShape::LevelCount] = { 0.0005, 0.002, 0.008 };
+    const double kLevelAngle[LodShape::LevelCount] = { 0.2, 0.35, 0.6 };
+}
+
+LodShape::LodShape(const TopoDS_Shape& shape)
+    : AIS_Shape(shape)
+    , m_diagonal(1.0)
+    , m_levels(LevelCount)
+    , m_requested(0)
+{
+    // Geometry bounds, not triangulation bounds, so the deflection does
+    // not depend on whether the shape was meshed before
+    BRepBndLib::Add(shape, m_bounds, Standard_False);
+    m_diagonal = diagonal(m_bounds);
+
+    // Presentations use the level meshes as they are instead of
+    // re-tessellating with the drawer's deviation
+    myDrawer->SetAutoTriangulation(Standard_False);
+
+    // Usually a no-op, Tessellator meshed it before display
+    m_levels[LevelCount - 1] = shape;
+    meshLevel(shape, LevelCount - 1, m_diagonal, true);
+}
+
+double LodShape::diagonal(const Bnd_Box& box) {
+    if (box.IsVoid()) return 1.0;
+    double d = std::sqrt(box.SquareExtent());
+    return d > 0.0 ? d : 1.0;
+}
+
+void LodShape::meshLevel(const TopoDS_Shape& shape, int level, double diagonal, bool parallel) {
+    // Faces that already carry a fine enough triangulation, e.g. one read
+    // back from the document, are left alone
+    BRepMesh_IncrementalMesh(shape, kLevelDeflection[level] * diagonal,
+                             Standard_False, kLevelAngle[level], parallel);
+}
+
+void LodShape::meshCoarsestLevel(const TopoDS_Shape& shape, bool parallel) {
+    if (shape.IsNull()) return;
+    Bnd_Box box;
+    BRepBndLib::Add(shape, box, Standard_False);
+    meshLevel(shape, LevelCount - 1, diagonal(box), parallel);
+}
+
+int LodShape::levelForScreenSize(double pixelSize, double maxErrorPixels) const {
+    for (int level = LevelCount - 1; level > 0; --level) {
+        if (kLevelDeflection[level] * pixelSize <= maxErrorPixels) return level;
+    }
+    return 0;
+}
+
+bool LodShape::hasLevel(int level) const {
+    return level >= 0 && level < LevelCount && !m_levels[level].IsNull();
+}
+
+int LodShape::nearestMeshedLevel(int level) const {
+    for (level = qMax(level, 0); level < LevelCount - 1; ++level) {
+        if (!m_levels[level].IsNull()) return level;
+    }
+    return LevelCount - 1;
+}
+
+bool LodShape::requestLevel(int level) {
+    if (level < 0 || level >= LevelCount || hasLevel(level)) return false;
+    if (m_requested & (1 << level)) return false;
+    m_requested |= 1 << level;
+    return true;
+}
+
+void LodShape::setLevel(int level, const TopoDS_Shape& mesh) {
+    if (level < 0 || level >= LevelCount - 1 || mesh.IsNull()) return;
+    m_levels[level] = mesh;
+    // In case the mode was computed from a coarser fallback
+    SetToUpdate(displayModeForLevel(level));
+}
+
+TopoDS_Shape LodShape::buildLevel(const TopoDS_Shape& shape, int level, double diagonal) {
+    if (shape.IsNull()) return TopoDS_Shape();
+
+    // Topology-only copies get their own faces, and so their own
+    // triangulations, while sharing the underlying geometry
+    BRepBuilderAPI_Copy copier(shape, Standard_False, Standard_False);
+    TopoDS_Shape mesh = copier.Shape();
+    meshLevel(mesh, level, diagonal, true);
+    return mesh;
+}
+
+Standard_Boolean LodShape::AcceptDisplayMode(const Standard_Integer mode) const {
+    int level = levelForDisplayMode(mode);
+    if (level >= 0 && level < LevelCount) return Standard_True;
+    return AIS_Shape::AcceptDisplayMode(mode);
+}
+
+void LodShape::Compute(const Handle(PrsMgr_PresentationManager)& manager,
+                       const Handle(Prs3d_Presentation)& presentation,
+                       const Standard_Integer mode) {
+    int level = levelForDisplayMode(mode);
+    if (level < 0 || level >= LevelCount) {
+        AIS_Shape::Compute(manager, presentation, mode);
+        return;
+    }
+
+    const TopoDS_Shape& mesh = m_levels[nearestMeshedLevel(level)];
+    if (mesh.IsNull()) return;
+    StdPrs_ShadedShape::Add(presentation, mesh, myDrawer);
+}
@@ -0,0 +1,75 @@
+#ifndef LODSHAPE_H
+#define LODSHAPE_H
+
+#include <AIS_Shape.hxx>
+#include <Bnd_Box.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <QVector>
+
+// Shaded shape with several cached tessellations of decreasing precision.
+// Each level is its own display mode, so swapping levels only toggles
+// presentations that the presentation manager already keeps. Level 0 is
+// the finest; the coarsest level is meshed on the shape itself so
+// selection and the wireframe modes use it, finer levels are meshed on
+// topological copies by a Tessellator job and handed back through
+// setLevel. Until then a finer mode shows the nearest meshed level.
+class LodShape : public AIS_Shape {
+public:
+    static const int LevelCount = 3;
+    // Display mode of level 0; level k uses FirstLodMode + k
+    static const int FirstLodMode = 10;
+
+    explicit LodShape(const TopoDS_Shape& shape);
+
+    const Bnd_Box& bounds() const { return m_bounds; }
+
+    // Coarsest level whose chordal deviation stays below maxErrorPixels
+    // when the bounding box diagonal covers pixelSize pixels on screen
+    int levelForScreenSize(double pixelSize, double maxErrorPixels = 1.0) const;
+    static int displayModeForLevel(int level) { return FirstLodMode + level; }
+    static int levelForDisplayMode(int mode) { return mode - FirstLodMode; }
+    bool hasLevel(int level) const;
+    // Finest meshed level no finer than level
+    int nearestMeshedLevel(int level) const;
+    // Marks a finer level as handed to a Tessellator job; false if it is
+    // meshed or was already requested. GUI thread only.
+    bool requestLevel(int level);
+    void setLevel(int level, const TopoDS_Shape& mesh);
+
+    // Topological copy of shape meshed for a finer level. Touches no
+    // LodShape, so it can run on a worker thread under the same rules as
+    // meshCoarsestLevel.
+    static TopoDS_Shape buildLevel(const TopoDS_Shape& shape, int level, double diagonal);
+    double diagonalLength() const { return m_diagonal; }
+
+    // Meshes shape the way the coarsest level is meshed, so a LodShape
+    // created for it later finds the triangulation already in place.
+    // Safe to call from a worker thread as long as no other thread reads
+    // or meshes the shape's faces meanwhile; see Tessellator.
+    static void meshCoarsestLevel(const TopoDS_Shape& shape, bool parallel);
+
+    Standard_Boolean AcceptDisplayMode(const Standard_Integer mode) const Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(LodShape, AIS_Shape)
+
+protected:
+    void Compute(const Handle(PrsMgr_PresentationManager)& manager,
+                 const Handle(Prs3d_Presentation)& presentation,
+                 const Standard_Integer mode) Standard_OVERRIDE;
+
+private:
+    static double diagonal(const Bnd_Box& box);
+    static void meshLevel(const TopoDS_Shape& shape, int level, double diagonal, bool parallel);
+
+    Bnd_Box m_bounds;
+    double m_diagonal;
+    // Null until the level is meshed
+    QVector<TopoDS_Shape> m_levels;
+    // Bit per level already requested from the tessellator
+    int m_requested;
+};
+
+DEFINE_STANDARD_HANDLE(LodShape, AIS_Shape)
+
+#endif
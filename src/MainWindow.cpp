@@ -1,6 +1,8 @@
 #include "MainWindow.h"
+#include "EntityImporter.h"
+#include "ShapeExporter.h"
+#include "SketchFile.h"
 
-#include <TDataStd_Name.hxx>
 
 #ifdef __unix__
 #include <fenv.h>
@@ -20,6 +22,9 @@
 #include <QPrintDialog>
 #include <QPdfWriter>
 #include <QPageLayout>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
 
 #ifdef HAVE_ECL
 QString eclObjectToQString(cl_object obj) {
@@ -71,6 +76,26 @@ MainWindow::MainWindow()
     setWindowTitle("AICAD - Open CASCADE CAD System");
     resize(1280, 800);
     setStatusBar(new QStatusBar(this));
+
+    m_io = new DocumentIO(this);
+    m_ioProgress = new QProgressBar(this);
+    m_ioProgress->setRange(0, 100);
+    m_ioProgress->setMaximumWidth(200);
+    m_ioCancel = new QPushButton("Cancel", this);
+    statusBar()->addPermanentWidget(m_ioProgress);
+    statusBar()->addPermanentWidget(m_ioCancel);
+    hideIoProgress();
+
+    connect(m_io, &DocumentIO::progress, m_ioProgress, &QProgressBar::setValue);
+    connect(m_io, &DocumentIO::saveFinished, this, &MainWindow::onSaveFinished);
+    connect(m_io, &DocumentIO::loadFinished, this, &MainWindow::onLoadFinished);
+    connect(m_io, &DocumentIO::exportFinished, this, &MainWindow::onExportFinished);
+    connect(m_ioCancel, &QPushButton::clicked, m_io, &DocumentIO::cancel);
+
+    // After the window is up, so a recovery prompt has a parent to show on
+    QTimer::singleShot(0, this, [this]() {
+        attachJournal(untitledJournalPath());
+    });
 }
 
 MainWindow::~MainWindow() {
@@ -88,8 +113,8 @@ cl_object MainWindow::lisp_getpoint(cl_narg narg, ...) {
     va_list args;
     va_start(args, narg);
 
-    QVector2D* basePoint = nullptr;
-    QVector2D tempBase;
+    gp_Pnt2d* basePoint = nullptr;
+    gp_Pnt2d tempBase;
     QString message = "Specify point: ";
 
     cl_object arg1 = Cnil;
@@ -115,7 +140,7 @@ cl_object MainWindow::lisp_getpoint(cl_narg narg, ...) {
             if (x_obj != Cnil && y_obj != Cnil) {
                 double x = ecl_to_double(x_obj);
                 double y = ecl_to_double(y_obj);
-                tempBase = QVector2D(x, y);
+                tempBase = gp_Pnt2d(x, y);
                 basePoint = &tempBase;
             }
         }
@@ -159,7 +184,7 @@ cl_object MainWindow::lisp_getpoint(cl_narg narg, ...) {
     }
 
     // Clear any previous result
-    mainWin->m_getPointResult = QVector2D(0, 0);
+    mainWin->m_getPointResult = gp_Pnt2d(0, 0);
     mainWin->m_getPointCompleted = false;
     mainWin->m_getPointCancelled = false;
 
@@ -179,8 +204,8 @@ cl_object MainWindow::lisp_getpoint(cl_narg narg, ...) {
     if (mainWin->m_getPointCompleted) {
         // Return as Lisp list (x y)
         cl_object result = cl_list(2,
-                                   ecl_make_single_float(mainWin->m_getPointResult.x()),
-                                   ecl_make_single_float(mainWin->m_getPointResult.y()));
+                                   ecl_make_double_float(mainWin->m_getPointResult.X()),
+                                   ecl_make_double_float(mainWin->m_getPointResult.Y()));
 
         return result;
     }
@@ -189,7 +214,133 @@ cl_object MainWindow::lisp_getpoint(cl_narg narg, ...) {
     return Cnil;
 }
 
-void MainWindow::startGetPoint(const QVector2D* basePoint, const QString& message) {
+cl_object MainWindow::lisp_regen_bench(cl_narg narg, ...) {
+    int pairs = 1000;
+
+    if (narg >= 1) {
+        va_list args;
+        va_start(args, narg);
+        cl_object arg1 = va_arg(args, cl_object);
+        va_end(args);
+
+        if (ECL_FIXNUMP(arg1)) {
+            pairs = qMax(1, (int)ecl_fixnum(arg1));
+        }
+    }
+
+    QByteArray report = Regenerator::benchmark(pairs).toUtf8();
+    return ecl_make_simple_base_string(report.constData(), report.size());
+}
+
+cl_object MainWindow::lisp_begin_edit() {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin) return Cnil;
+
+    mainWin->beginEdit();
+    return Ct;
+}
+
+cl_object MainWindow::lisp_end_edit() {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin || !mainWin->m_document.inBatch()) return Cnil;
+
+    mainWin->endEdit();
+    return Ct;
+}
+
+cl_object MainWindow::lisp_abort_edit() {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin || !mainWin->m_document.inBatch()) return Cnil;
+
+    mainWin->abortEdit();
+    return Ct;
+}
+
+cl_object MainWindow::lisp_undo() {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin || !mainWin->m_document.canUndo()) return Cnil;
+
+    mainWin->onUndo();
+    return Ct;
+}
+
+cl_object MainWindow::lisp_redo() {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin || !mainWin->m_document.canRedo()) return Cnil;
+
+    mainWin->onRedo();
+    return Ct;
+}
+
+cl_object MainWindow::lisp_frame_stats(cl_narg narg, ...) {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin) return Cnil;
+
+    bool reset = false;
+    if (narg >= 1) {
+        va_list args;
+        va_start(args, narg);
+        reset = va_arg(args, cl_object) != Cnil;
+        va_end(args);
+    }
+
+    QByteArray report = mainWin->m_view->frameStatsReport().toUtf8();
+    if (reset) mainWin->m_view->resetFrameStats();
+    return ecl_make_simple_base_string(report.constData(), report.size());
+}
+
+cl_object MainWindow::lisp_input_latency(cl_narg narg, ...) {
+    MainWindow* mainWin = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!mainWin) return Cnil;
+
+    bool reset = false;
+    if (narg >= 1) {
+        va_list args;
+        va_start(args, narg);
+        reset = va_arg(args, cl_object) != Cnil;
+        va_end(args);
+    }
+
+    QByteArray report = mainWin->m_view->latencyReport().toUtf8();
+    if (reset) mainWin->m_view->resetLatencyStats();
+    return ecl_make_simple_base_string(report.constData(), report.size());
+}
+
+void MainWindow::beginEdit() {
+    m_document.beginBatch();
+    m_view->beginUpdate();
+}
+
+void MainWindow::endEdit() {
+    bool kept = m_document.endBatch();
+    m_view->endUpdate();
+    if (m_document.inBatch()) return;
+
+    if (kept) {
+        updateFeatureTree();
+    } else {
+        documentReverted();
+    }
+}
+
+void MainWindow::abortEdit() {
+    m_document.abortBatch();
+    m_view->endUpdate();
+    if (!m_document.inBatch()) documentReverted();
+}
+
+void MainWindow::documentReverted() {
+    // The active sketch may have been created by the reverted step
+    if (!m_activeSketch.IsNull() && m_document.getFeatureId(m_activeSketch) < 0) {
+        m_activeSketch.Nullify();
+        m_view->setPendingSketch(TDF_Label());
+    }
+
+    m_view->displayAllFeatures();
+    updateFeatureTree();
+}
+
+void MainWindow::startGetPoint(const gp_Pnt2d* basePoint, const QString& message) {
     if (m_activeSketch.IsNull()) {
         statusBar()->showMessage("No active sketch. Please create a sketch first.");
         return;
@@ -373,6 +524,10 @@ void MainWindow::createMenusAndToolbars() {
 
 void MainWindow::createCentral() {
     m_view = new CadView(this);
+
+    // Built shapes survive restarts, so reopening a document skips rebuilds
+    m_view->regenerator().cache().setDiskDirectory(
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shapes");
     m_view->setDocument(&m_document);
 
     connect(m_view, &CadView::pointAcquired, this, &MainWindow::onPointAcquired);
@@ -450,18 +605,19 @@ void MainWindow::onCreateSketch() {
 
         QString tempName = QString("Sketch (%1)").arg(plane.getDisplayName());
 
+        beginEdit();
         m_activeSketch = m_document.createSketch(plane, tempName);
 
         int sketchId = m_document.getFeatureId(m_activeSketch);
         QString name = QString("Sketch %1 (%2)").arg(sketchId).arg(plane.getDisplayName());
-        TDataStd_Name::Set(m_activeSketch, TCollection_ExtendedString(name.toStdWString().c_str()));
+        m_document.setFeatureName(m_activeSketch, name);
+        endEdit();
 
         m_view->setPendingSketch(m_activeSketch);
 
         // Set view to face the sketch plane
         m_view->setSketchView(targetView);
 
-        updateFeatureTree();
         statusBar()->showMessage(QString("Sketch created on %1 plane. Use sketch tools to add geometry.").arg(plane.getDisplayName()));
     }
 }
@@ -502,7 +658,7 @@ void MainWindow::onDrawLine() {
 }
 
 // Update onPointAcquired - completely rewritten to handle rectangle properly:
-void MainWindow::onPointAcquired(QVector2D point) {
+void MainWindow::onPointAcquired(gp_Pnt2d point) {
     // Handle getpoint mode
     if (m_waitingForGetPoint) {
         m_getPointResult = point;
@@ -512,8 +668,8 @@ void MainWindow::onPointAcquired(QVector2D point) {
         m_view->setMode(CadMode::Idle);
         m_view->setRubberBandMode(RubberBandMode::None);
         statusBar()->showMessage(QString("Point acquired: (%1, %2)")
-                                     .arg(point.x(), 0, 'f', 2)
-                                     .arg(point.y(), 0, 'f', 2));
+                                     .arg(point.X(), 0, 'f', 2)
+                                     .arg(point.Y(), 0, 'f', 2));
         return;
     }
 
@@ -523,39 +679,49 @@ void MainWindow::onPointAcquired(QVector2D point) {
         // This is the SECOND point (first point is already stored in CadView)
         // Get both points from the signal
         statusBar()->showMessage(QString("Second corner: (%1, %2). Creating rectangle...")
-                                     .arg(point.x(), 0, 'f', 2)
-                                     .arg(point.y(), 0, 'f', 2));
+                                     .arg(point.X(), 0, 'f', 2)
+                                     .arg(point.Y(), 0, 'f', 2));
 
         // Get the first point from CadView's internal storage
-        QVector<QVector2D> points = m_view->getSketchPoints();
+        QVector<gp_Pnt2d> points = m_view->getSketchPoints();
         if (points.size() >= 1) {
-            QVector2D p1 = points[0];
-            QVector2D p2 = point;
-
-            // Create closed rectangle (5 points)
-            QVector<QVector2D> rectPoints;
-            rectPoints.append(QVector2D(p1.x(), p1.y()));
-            rectPoints.append(QVector2D(p2.x(), p1.y()));
-            rectPoints.append(QVector2D(p2.x(), p2.y()));
-            rectPoints.append(QVector2D(p1.x(), p2.y()));
-            rectPoints.append(QVector2D(p1.x(), p1.y())); // Close the loop
-
-            m_document.addPolylineToSketch(m_activeSketch, rectPoints);
+            gp_Pnt2d p1 = points[0];
+            gp_Pnt2d p2 = point;
+
+            // Create closed rectangle (5 points), in double so snapped
+            // corners keep their exact coordinates
+            const double rectPoints[] = {
+                p1.X(), p1.Y(),
+                p2.X(), p1.Y(),
+                p2.X(), p2.Y(),
+                p1.X(), p2.Y(),
+                p1.X(), p1.Y()  // Close the loop
+            };
+
+            beginEdit();
+            if (!m_document.addPolylineToSketch(m_activeSketch, rectPoints, 5)) {
+                abortEdit();
+                m_view->setMode(CadMode::Idle);
+                m_view->setRubberBandMode(RubberBandMode::None);
+                statusBar()->showMessage("Cannot read the sketch from its file; rectangle not added.");
+                return;
+            }
             m_view->displayFeature(m_activeSketch);
+            endEdit();
 
             // Reset state
             m_view->setMode(CadMode::Idle);
             m_view->setRubberBandMode(RubberBandMode::None);
 
             statusBar()->showMessage(QString("Rectangle created: %1 x %2")
-                                         .arg(qAbs(p2.x() - p1.x()), 0, 'f', 2)
-                                         .arg(qAbs(p2.y() - p1.y()), 0, 'f', 2));
+                                         .arg(qAbs(p2.X() - p1.X()), 0, 'f', 2)
+                                         .arg(qAbs(p2.Y() - p1.Y()), 0, 'f', 2));
         }
     } else if (m_view->getRubberBandMode() == RubberBandMode::Polyline) {
         // Handle polyline point acquisition
         statusBar()->showMessage(QString("Point added: (%1, %2). Click next point or press Enter to finish...")
-                                     .arg(point.x(), 0, 'f', 2)
-                                     .arg(point.y(), 0, 'f', 2));
+                                     .arg(point.X(), 0, 'f', 2)
+                                     .arg(point.Y(), 0, 'f', 2));
     }
 }
 
@@ -587,21 +753,69 @@ void MainWindow::onCreateExtrude() {
 
     if (ok) {
         QString tempName = "Extrude";
+        beginEdit();
         TDF_Label extrudeLabel = m_document.createExtrude(m_activeSketch, height, tempName);
 
         int extrudeId = m_document.getFeatureId(extrudeLabel);
         QString name = QString("Extrude %1").arg(extrudeId);
-        TDataStd_Name::Set(extrudeLabel, TCollection_ExtendedString(name.toStdWString().c_str()));
+        m_document.setFeatureName(extrudeLabel, name);
 
         m_view->displayFeature(extrudeLabel);
+        endEdit();
         m_view->fitAll();
 
-        updateFeatureTree();
         statusBar()->showMessage(QString("Extrude created with height %1").arg(height));
     }
 }
 
+void MainWindow::showIoProgress(const QString& message) {
+    m_ioProgress->setValue(0);
+    m_ioProgress->show();
+    m_ioCancel->show();
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::hideIoProgress() {
+    m_ioProgress->hide();
+    m_ioCancel->hide();
+}
+
+QString MainWindow::untitledJournalPath() {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    return QDir(dir).filePath("untitled.ocaf.journal");
+}
+
+void MainWindow::attachJournal(const QString& path) {
+    bool keep = false;
+    int edits = m_document.journalEditCount(path);
+    if (edits > 0) {
+        QMessageBox::StandardButton answer = QMessageBox::question(this, "Recover Edits",
+            QString("%1 unsaved edit(s) from a previous session were found. Recover them?").arg(edits));
+        if (answer == QMessageBox::Yes) {
+            keep = m_document.replayJournal(path);
+            if (!keep) {
+                QMessageBox::warning(this, "Recover Edits",
+                    "The edits do not match the saved document and were not recovered.");
+            }
+            m_activeSketch.Nullify();
+            m_view->setPendingSketch(TDF_Label());
+            m_view->displayAllFeatures();
+            updateFeatureTree();
+        }
+    }
+
+    if (!m_document.startJournal(path, keep)) {
+        statusBar()->showMessage("Edit journal unavailable; edits are not protected against crashes.");
+    }
+}
+
 void MainWindow::onSave() {
+    if (m_io->isBusy()) {
+        statusBar()->showMessage("A document is still being saved or loaded.");
+        return;
+    }
+
     QString filename = QFileDialog::getSaveFileName(this, "Save Document",
                                                     "", "OCAF Documents (*.ocaf)");
 
@@ -610,29 +824,112 @@ void MainWindow::onSave() {
             filename += ".ocaf";
         }
 
-        if (m_document.saveDocument(filename)) {
-            statusBar()->showMessage("Document saved: " + filename);
+        // The document is snapshotted here; editing can go on while the
+        // snapshot is written. Copying reads the shapes a mesh job may
+        // still be writing to.
+        m_view->waitForMeshing();
+        if (m_io->startSave(m_document, filename)) {
+            showIoProgress("Saving " + filename + "...");
         } else {
             QMessageBox::critical(this, "Error", "Failed to save document.");
         }
     }
 }
 
+void MainWindow::onSaveFinished(bool ok, const QString& filename) {
+    hideIoProgress();
+    if (ok) {
+        m_document.markSaved(filename);
+        statusBar()->showMessage("Document saved: " + filename);
+    } else {
+        m_document.discardSnapshot();
+        QMessageBox::critical(this, "Error", "Failed to save document.");
+    }
+}
+
 void MainWindow::onLoad() {
+    if (m_io->isBusy()) {
+        statusBar()->showMessage("A document is still being saved or loaded.");
+        return;
+    }
+
     QString filename = QFileDialog::getOpenFileName(this, "Open Document",
                                                     "", "OCAF Documents (*.ocaf)");
 
     if (!filename.isEmpty()) {
-        if (m_document.loadDocument(filename)) {
-            m_view->displayAllFeatures();
-            updateFeatureTree();
-            statusBar()->showMessage("Document loaded: " + filename);
+        // Lazy: the tree is filled from the feature headers right away and
+        // geometry streams into the view afterwards
+        if (m_io->startLoad(filename, LoadMode::Lazy)) {
+            showIoProgress("Loading " + filename + "...");
         } else {
             QMessageBox::critical(this, "Error", "Failed to load document.");
         }
     }
 }
 
+void MainWindow::onLoadFinished(bool ok, const QString& filename) {
+    hideIoProgress();
+    if (!ok) {
+        statusBar()->showMessage("Document not loaded: " + filename);
+        return;
+    }
+
+    // The current document stays usable until the loaded one is complete
+    if (m_io->takeLoaded(m_document)) {
+        m_activeSketch.Nullify();
+        m_view->setPendingSketch(TDF_Label());
+        m_view->displayAllFeatures();
+        updateFeatureTree();
+        statusBar()->showMessage("Document loaded: " + filename);
+        attachJournal(OcafDocument::journalPath(filename));
+    } else {
+        QMessageBox::critical(this, "Error", "Failed to load document.");
+    }
+}
+
+void MainWindow::onImportSketches() {
+    QString filename = QFileDialog::getOpenFileName(this, "Import Sketches",
+                                                    "", "AICAD Sketch Files (*.aisk)");
+    if (filename.isEmpty()) return;
+
+    SketchFile file;
+    if (!file.open(filename)) {
+        QMessageBox::critical(this, "Error", "Failed to import sketches: " + file.errorString());
+        return;
+    }
+
+    beginEdit();
+    int added = file.addToDocument(m_document);
+    m_view->displayAllFeatures();
+    endEdit();
+
+    statusBar()->showMessage(QString("Imported %1 feature(s) from %2").arg(added).arg(filename));
+}
+
+void MainWindow::onImportDrawing() {
+    QString filename = QFileDialog::getOpenFileName(this, "Import Drawing",
+                                                    "", "LINE/ARC Drawings (*.txt)");
+    if (filename.isEmpty()) return;
+
+    // Into a new sketch on the XY plane, as the 2D drawings were drawn
+    beginEdit();
+    TDF_Label sketch = m_document.createSketch(CustomPlane::XY(), QFileInfo(filename).completeBaseName());
+    EntityImporter::Result result = EntityImporter().import(filename, m_document, sketch);
+    if (!result.ok) {
+        abortEdit();
+        QMessageBox::critical(this, "Error", "Failed to import drawing: " + result.error);
+        return;
+    }
+    m_view->displayFeature(sketch);
+    endEdit();
+
+    QString message = QString("Imported %1 entities in %2 ms").arg(result.entities).arg(result.milliseconds, 0, 'f', 0);
+    if (result.skipped > 0) {
+        message += QString(", skipped %1 line(s) starting at line %2").arg(result.skipped).arg(result.firstSkippedLine);
+    }
+    statusBar()->showMessage(message);
+}
+
 void MainWindow::onPrint() {
     statusBar()->showMessage("Print functionality not yet implemented.");
 }
@@ -650,6 +947,46 @@ void MainWindow::onExportPdf() {
     }
 }
 
+void MainWindow::onExportShapes() {
+    if (m_io->isBusy()) {
+        statusBar()->showMessage("A document is still being saved or loaded.");
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, "Export Shapes", "",
+        "STEP Files (*.step *.stp);;IGES Files (*.iges *.igs);;BREP Files (*.brep)");
+    if (filename.isEmpty()) return;
+
+    ShapeExporter::Format format;
+    if (!ShapeExporter::formatForPath(filename, format)) {
+        QMessageBox::critical(this, "Error", "Unknown shape file format: " + filename);
+        return;
+    }
+
+    // The part shapes are copied here; a mesh job must not be writing
+    // to them meanwhile
+    m_view->waitForMeshing();
+    if (m_io->startExport(m_document, filename, format)) {
+        showIoProgress("Exporting " + filename + "...");
+    } else {
+        QMessageBox::critical(this, "Error", "Failed to export shapes.");
+    }
+}
+
+void MainWindow::onExportFinished(bool ok, const QString& filename, int parts, int missing) {
+    hideIoProgress();
+    if (!ok) {
+        QMessageBox::critical(this, "Error", "Failed to export shapes to " + filename + ".");
+        return;
+    }
+
+    QString message = QString("Exported %1 part(s) to %2").arg(parts).arg(filename);
+    if (missing > 0) {
+        message += QString(", %1 feature(s) without a shape left out").arg(missing);
+    }
+    statusBar()->showMessage(message);
+}
+
 void MainWindow::onViewTop() {
     m_view->setSketchView(SketchView::Top);
     statusBar()->showMessage("View: Top");
@@ -670,6 +1007,32 @@ void MainWindow::onViewIsometric() {
     statusBar()->showMessage("View: Isometric");
 }
 
+void MainWindow::onUndo() {
+    if (m_document.inBatch()) {
+        statusBar()->showMessage("Cannot undo while an edit is in progress.");
+        return;
+    }
+    if (!m_document.undo()) {
+        statusBar()->showMessage("Nothing to undo.");
+        return;
+    }
+    documentReverted();
+    statusBar()->showMessage("Undo");
+}
+
+void MainWindow::onRedo() {
+    if (m_document.inBatch()) {
+        statusBar()->showMessage("Cannot redo while an edit is in progress.");
+        return;
+    }
+    if (!m_document.redo()) {
+        statusBar()->showMessage("Nothing to redo.");
+        return;
+    }
+    documentReverted();
+    statusBar()->showMessage("Redo");
+}
+
 void MainWindow::onExit() {
     close();
 }
@@ -846,6 +1209,43 @@ void MainWindow::initECL() {
                           (cl_objectfn)lisp_getpoint,
                           0);  // 0 = no required arguments (all optional)
 
+    // (regen-bench [pairs]) - parallel regeneration speedup report
+    ecl_def_c_function_va(ecl_make_symbol("REGEN-BENCH", "CL-USER"),
+                          (cl_objectfn)lisp_regen_bench,
+                          0);
+
+    // (begin-edit) ... (end-edit) - one undo step and one redraw for
+    // everything in between; (abort-edit) discards it instead
+    ecl_def_c_function(ecl_make_symbol("BEGIN-EDIT", "CL-USER"),
+                       (cl_objectfn_fixed)lisp_begin_edit, 0);
+    ecl_def_c_function(ecl_make_symbol("END-EDIT", "CL-USER"),
+                       (cl_objectfn_fixed)lisp_end_edit, 0);
+    ecl_def_c_function(ecl_make_symbol("ABORT-EDIT", "CL-USER"),
+                       (cl_objectfn_fixed)lisp_abort_edit, 0);
+    ecl_def_c_function(ecl_make_symbol("UNDO", "CL-USER"),
+                       (cl_objectfn_fixed)lisp_undo, 0);
+    ecl_def_c_function(ecl_make_symbol("REDO", "CL-USER"),
+                       (cl_objectfn_fixed)lisp_redo, 0);
+
+    // (frame-stats [reset]) - full scene vs. overlay-only redraw times
+    ecl_def_c_function_va(ecl_make_symbol("FRAME-STATS", "CL-USER"),
+                          (cl_objectfn)lisp_frame_stats,
+                          0);
+
+    // (input-latency [reset]) - mouse input to presented frame histogram
+    ecl_def_c_function_va(ecl_make_symbol("INPUT-LATENCY", "CL-USER"),
+                          (cl_objectfn)lisp_input_latency,
+                          0);
+
+    // (with-edit body...) - commits on normal exit, aborts on error
+    cl_eval(c_string_to_object(
+        "(defmacro with-edit (&body body)"
+        "  (let ((ok (gensym)))"
+        "    `(let ((,ok nil))"
+        "       (begin-edit)"
+        "       (unwind-protect (multiple-value-prog1 (progn ,@body) (setf ,ok t))"
+        "         (if ,ok (end-edit) (abort-edit))))))"));
+
 
     QWidget *central = centralWidget();
     QVBoxLayout *overlay = new QVBoxLayout();
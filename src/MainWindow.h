@@ -25,9 +25,11 @@
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QStatusBar>
+#include <QProgressBar>
 #include <QDebug>
 
 #include "CadView.h"
+#include "DocumentIO.h"
 #include "OcafDocument.h"
 
 class MainWindow : public QMainWindow {
@@ -45,7 +47,7 @@ protected:
 private Q_SLOTS:
     void executeCommand();
     void fadeOutResult();
-    void onPointAcquired(QVector2D point);
+    void onPointAcquired(gp_Pnt2d point);
     void onGetPointCancelled();
 
     void onDrawRectangle();
@@ -54,12 +56,20 @@ private Q_SLOTS:
     void onCreateExtrude();
     void onSave();
     void onLoad();
+    void onSaveFinished(bool ok, const QString& filename);
+    void onLoadFinished(bool ok, const QString& filename);
+    void onExportFinished(bool ok, const QString& filename, int parts, int missing);
+    void onImportSketches();
+    void onImportDrawing();
     void onPrint();
     void onExportPdf();
+    void onExportShapes();
     void onViewTop();
     void onViewFront();
     void onViewRight();
     void onViewIsometric();
+    void onUndo();
+    void onRedo();
     void onExit();
 
     void onFeatureSelected(QTreeWidgetItem* item, int column);
@@ -68,15 +78,30 @@ private Q_SLOTS:
 private:
 
     bool m_waitingForGetPoint;
-    QVector2D m_getPointBase;
+    gp_Pnt2d m_getPointBase;
     bool m_hasGetPointBase;
     QString m_getPointMessage;
-    QVector2D m_getPointResult;
+    gp_Pnt2d m_getPointResult;
     bool m_getPointCompleted;
     bool m_getPointCancelled;
 
     static cl_object lisp_getpoint(cl_narg narg, ...);
-    void startGetPoint(const QVector2D* basePoint = nullptr, const QString& message = "");
+    static cl_object lisp_regen_bench(cl_narg narg, ...);
+    static cl_object lisp_begin_edit();
+    static cl_object lisp_end_edit();
+    static cl_object lisp_abort_edit();
+    static cl_object lisp_undo();
+    static cl_object lisp_redo();
+    static cl_object lisp_frame_stats(cl_narg narg, ...);
+    static cl_object lisp_input_latency(cl_narg narg, ...);
+    void startGetPoint(const gp_Pnt2d* basePoint = nullptr, const QString& message = "");
+
+    // One undo step and one viewer update per outermost edit; nested
+    // edits (e.g. commands run from a Lisp batch) merge into it
+    void beginEdit();
+    void endEdit();
+    void abortEdit();
+    void documentReverted();
 
 // Unified command system
     struct CADCommand {
@@ -135,6 +160,18 @@ private:
 
     OcafDocument m_document;
 
+    // Background save/load and its status bar progress
+    DocumentIO* m_io;
+    QProgressBar* m_ioProgress;
+    QPushButton* m_ioCancel;
+    void showIoProgress(const QString& message);
+    void hideIoProgress();
+
+    // Starts the edit journal at path, offering to replay what a previous
+    // session left there first
+    void attachJournal(const QString& path);
+    static QString untitledJournalPath();
+
     TDF_Label m_pendingSketch;
     TDF_Label m_activeSketch;
 
@@ -3,8 +3,14 @@
 #include <TDataStd_RealArray.hxx>
 #include <TDataStd_IntegerArray.hxx>
 #include <TDF_ChildIterator.hxx>
-#include <BinDrivers.hxx>
+#include <TDF_AttributeDelta.hxx>
+#include <TDF_AttributeDeltaList.hxx>
+#include <TDF_Tool.hxx>
+#include <TDF_CopyLabel.hxx>
+#include "DocumentDrivers.h"
+#include "SketchGeometryAttribute.h"
 #include <QFile>
+#include <QDebug>
 
 static const Standard_GUID GUID_FEATURE_TYPE("12345678-1234-1234-1234-000000000001");
 static const Standard_GUID GUID_FEATURE_ID("12345678-1234-1234-1234-000000000002");
@@ -14,110 +20,581 @@ static const Standard_GUID GUID_PLANE_UAXIS("12345678-1234-1234-1234-00000000000
 static const Standard_GUID GUID_PLANE_VAXIS("12345678-1234-1234-1234-000000000006");
 static const Standard_GUID GUID_EXTRUDE_HEIGHT("12345678-1234-1234-1234-000000000007");
 static const Standard_GUID GUID_EXTRUDE_SKETCH("12345678-1234-1234-1234-000000000008");
+// Legacy per-polyline child labels, converted to SketchGeometryAttribute on load
 static const Standard_GUID GUID_POLYLINES("12345678-1234-1234-1234-000000000009");
 
-CustomPlane CustomPlane::XY() {
-    CustomPlane p;
-    p.origin = QVector3D(0, 0, 0);
-    p.normal = QVector3D(0, 0, 1);
-    p.uAxis = QVector3D(1, 0, 0);
-    p.vAxis = QVector3D(0, 1, 0);
-    return p;
-}
-
-CustomPlane CustomPlane::XZ() {
-    CustomPlane p;
-    p.origin = QVector3D(0, 0, 0);
-    p.normal = QVector3D(0, 1, 0);
-    p.uAxis = QVector3D(1, 0, 0);
-    p.vAxis = QVector3D(0, 0, 1);
-    return p;
-}
+static const Standard_Integer UNDO_LIMIT = 100;
 
-CustomPlane CustomPlane::YZ() {
-    CustomPlane p;
-    p.origin = QVector3D(0, 0, 0);
-    p.normal = QVector3D(1, 0, 0);
-    p.uAxis = QVector3D(0, 1, 0);
-    p.vAxis = QVector3D(0, 0, 1);
-    return p;
+OcafDocument::OcafDocument()
+    : m_nextFeatureId(1), m_batchDepth(0), m_batchAborted(false), m_loadMode(LoadMode::Full),
+      m_savedJournalPos(0), m_undoFloor(0), m_pendingUndoFloor(-1) {
+    m_app = createApplication();
 }
 
-QString CustomPlane::getDisplayName() const {
-    if (normal == QVector3D(0, 0, 1) && origin == QVector3D(0, 0, 0))
-        return "XY";
-    if (normal == QVector3D(0, 1, 0) && origin == QVector3D(0, 0, 0))
-        return "XZ";
-    if (normal == QVector3D(1, 0, 0) && origin == QVector3D(0, 0, 0))
-        return "YZ";
-    return QString("Custom (%1, %2, %3)")
-        .arg(normal.x(), 0, 'f', 2)
-        .arg(normal.y(), 0, 'f', 2)
-        .arg(normal.z(), 0, 'f', 2);
-}
-
-gp_Pln CustomPlane::toGpPln() const {
-    gp_Pnt origin_pnt(origin.x(), origin.y(), origin.z());
-    gp_Dir normal_dir(normal.x(), normal.y(), normal.z());
-    return gp_Pln(origin_pnt, normal_dir);
+OcafDocument::~OcafDocument() {
+    if (!m_doc.IsNull()) {
+        m_app->Close(m_doc);
+    }
 }
 
-gp_Ax2 CustomPlane::toGpAx2() const {
-    gp_Pnt origin_pnt(origin.x(), origin.y(), origin.z());
-    gp_Dir normal_dir(normal.x(), normal.y(), normal.z());
-    gp_Dir uaxis_dir(uAxis.x(), uAxis.y(), uAxis.z());
-    return gp_Ax2(origin_pnt, normal_dir, uaxis_dir);
+Handle(TDocStd_Application) OcafDocument::createApplication() {
+    Handle(TDocStd_Application) app = new TDocStd_Application();
+    DocumentDrivers::defineFormat(app);
+    return app;
 }
 
-OcafDocument::OcafDocument() : m_nextFeatureId(1) {
-    m_app = XCAFApp_Application::GetApplication();
-    BinDrivers::DefineFormat(m_app);
+Handle(PCDM_ReaderFilter) OcafDocument::readerFilter(LoadMode mode) {
+    Handle(PCDM_ReaderFilter) filter;
+    if (mode == LoadMode::Lazy) {
+        filter = new PCDM_ReaderFilter(PCDM_ReaderFilter::AppendMode_Forbid);
+        filter->AddSkipped(STANDARD_TYPE(SketchGeometryAttribute));
+        filter->AddSkipped(STANDARD_TYPE(TNaming_NamedShape));
+    }
+    return filter;
 }
 
-OcafDocument::~OcafDocument() {
+bool OcafDocument::newDocument() {
+    stopJournal();
     if (!m_doc.IsNull()) {
         m_app->Close(m_doc);
     }
+    m_app->NewDocument("BinOcaf", m_doc);
+    m_nextFeatureId = 1;
+    m_batchDepth = 0;
+    m_batchAborted = false;
+    m_undoFloor = 0;
+    m_pendingUndoFloor = -1;
+    m_featureIndex.clear();
+    m_graph.clear();
+
+    if (m_doc.IsNull()) return false;
+    m_doc->SetUndoLimit(UNDO_LIMIT);
+    return true;
 }
 
-bool OcafDocument::newDocument() {
+void OcafDocument::closeDocument() {
+    stopJournal();
     if (!m_doc.IsNull()) {
         m_app->Close(m_doc);
     }
-    m_app->NewDocument("BinOcaf", m_doc);
-    m_nextFeatureId = 1;
-    return !m_doc.IsNull();
+    m_doc.Nullify();
+    m_sourcePath.clear();
+    m_unloaded.clear();
+    m_batchDepth = 0;
+    m_batchAborted = false;
+    m_undoFloor = 0;
+    m_pendingUndoFloor = -1;
+    m_featureIndex.clear();
+    m_graph.clear();
 }
 
 bool OcafDocument::saveDocument(const QString& filename) {
     if (m_doc.IsNull()) return false;
 
+    // Whatever is still only in the source file has to be read before
+    // the document is written, possibly over that same file
+    if (hasUnloadedFeatures() && !materialize(getFeatures())) return false;
+
     TCollection_ExtendedString path(filename.toStdWString().c_str());
-    return m_app->SaveAs(m_doc, path) == PCDM_SS_OK;
+    if (m_app->SaveAs(m_doc, path) != PCDM_SS_OK) return false;
+
+    m_savedJournalPos = m_journal.position();
+    m_pendingUndoFloor = m_doc->GetUndos().Extent();
+    markSaved(filename);
+    return true;
 }
 
-bool OcafDocument::loadDocument(const QString& filename) {
-    if (!QFile::exists(filename)) return false;
+void OcafDocument::markSaved(const QString& filename) {
+    m_sourcePath = filename;
+    if (m_pendingUndoFloor >= 0) m_undoFloor = m_pendingUndoFloor;
+    m_pendingUndoFloor = -1;
+    if (m_journal.isOpen()) {
+        m_journal.rebase(journalPath(filename), EditJournal::baseOf(filename), m_savedJournalPos);
+    }
+}
 
-    if (!m_doc.IsNull()) {
-        m_app->Close(m_doc);
+void OcafDocument::discardSnapshot() {
+    m_pendingUndoFloor = -1;
+}
+
+int OcafDocument::undoFloor() const {
+    if (!m_journal.isOpen()) return 0;
+    return qMax(m_undoFloor, m_pendingUndoFloor);
+}
+
+Handle(TDocStd_Document) OcafDocument::snapshot(const Handle(TDocStd_Application)& app) {
+    Handle(TDocStd_Document) copy;
+    if (m_doc.IsNull()) return copy;
+
+    // The copy must not depend on the source file, which the save may
+    // overwrite
+    if (hasUnloadedFeatures() && !materialize(getFeatures())) return copy;
+
+    app->NewDocument("BinOcaf", copy);
+    if (copy.IsNull()) return copy;
+    m_savedJournalPos = m_journal.position();
+    // Until the save completes, undo must not cross either base
+    m_pendingUndoFloor = m_doc->GetUndos().Extent();
+
+    // Attributes are copied, shapes get new topology over shared geometry
+    // and SketchGeometryAttribute::Paste shares the implicitly shared
+    // buffers, so later edits detach instead of touching the copy
+    TDF_CopyLabel copier(m_doc->Main(), copy->Main());
+    copier.Perform();
+    if (!copier.IsDone()) {
+        app->Close(copy);
+        copy.Nullify();
     }
+    return copy;
+}
 
+bool OcafDocument::loadDocument(const QString& filename, LoadMode mode) {
+    if (!QFile::exists(filename)) return false;
+
+    // Closed first, the application refuses to open a file twice
+    closeDocument();
+
+    Handle(TDocStd_Document) doc;
     TCollection_ExtendedString path(filename.toStdWString().c_str());
-    PCDM_ReaderStatus status = m_app->Open(path, m_doc);
+    if (m_app->Open(path, doc, readerFilter(mode)) != PCDM_RS_OK) return false;
+
+    return adoptDocument(m_app, doc, filename, mode);
+}
+
+bool OcafDocument::adoptDocument(const Handle(TDocStd_Application)& app,
+                                 const Handle(TDocStd_Document)& doc,
+                                 const QString& filename, LoadMode mode) {
+    if (doc.IsNull()) return false;
 
-    if (status != PCDM_RS_OK) return false;
+    if (doc != m_doc) closeDocument();
+    m_app = app;
+    m_doc = doc;
+
+    // Before undo is enabled, so the conversion is not an undoable step
+    convertLegacyPolylines();
+    m_doc->SetUndoLimit(UNDO_LIMIT);
+    m_sourcePath = filename;
+    m_loadMode = mode;
+
+    m_nextFeatureId = 1;
+    rebuildFeatureIndex();
+    Q_ASSERT(verifyFeatureIndex());
+    rebuildGraph();
+
+    if (mode == LoadMode::Lazy) {
+        // Stored shapes are taken as current; materialize dirties the
+        // extrudes that turn out to have none
+        for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+            m_unloaded.insert(it.key());
+            m_graph.clearDirty(it.key());
+        }
+    }
+
+    return true;
+}
+
+QString OcafDocument::journalPath(const QString& documentPath) {
+    return documentPath + ".journal";
+}
+
+int OcafDocument::journalEditCount(const QString& path) const {
+    QVector<EditJournal::Entry> entries;
+    if (!EditJournal::read(path, EditJournal::baseOf(m_sourcePath), entries)) return 0;
+
+    int count = 0;
+    for (const EditJournal::Entry& entry : entries) {
+        if (entry.type >= EditJournal::CreateSketch) ++count;
+    }
+    return count;
+}
+
+bool OcafDocument::startJournal(const QString& path, bool keep) {
+    // Kept records were replayed on top of the save; the floor was set
+    // there
+    if (!keep && !m_doc.IsNull()) {
+        m_undoFloor = m_doc->GetUndos().Extent();
+        m_pendingUndoFloor = -1;
+    }
+    return m_journal.open(path, EditJournal::baseOf(m_sourcePath), keep);
+}
+
+void OcafDocument::stopJournal() {
+    m_journal.close();
+}
+
+bool OcafDocument::replayJournal(const QString& path) {
+    QVector<EditJournal::Entry> entries;
+    if (m_doc.IsNull() || !EditJournal::read(path, EditJournal::baseOf(m_sourcePath), entries)) {
+        return false;
+    }
+
+    // Replayed edits must not be logged a second time
+    stopJournal();
+    m_undoFloor = m_doc->GetUndos().Extent();
+    m_pendingUndoFloor = -1;
+
+    // The same calls in the same order give the same feature IDs; a
+    // mismatch means the journal does not fit this document after all
+    bool ok = true;
+    bool commandOpen = false;
+    for (const EditJournal::Entry& entry : entries) {
+        switch (entry.type) {
+        case EditJournal::OpenCommand:
+            openCommand();
+            commandOpen = true;
+            break;
+        case EditJournal::CommitCommand:
+            commitCommand();
+            commandOpen = false;
+            break;
+        case EditJournal::AbortCommand:
+            abortCommand();
+            commandOpen = false;
+            break;
+        case EditJournal::Undo:
+            ok = undo();
+            break;
+        case EditJournal::Redo:
+            ok = redo();
+            break;
+        case EditJournal::CreateSketch:
+            ok = getFeatureId(createSketch(entry.plane, entry.name)) == entry.featureId;
+            break;
+        case EditJournal::AddPolyline: {
+            TDF_Label sketch = findFeature(entry.featureId);
+            ok = !sketch.IsNull() && addPolylineToSketch(sketch, entry.xy.constData(), entry.xy.size() / 2);
+            break;
+        }
+        case EditJournal::CreateExtrude: {
+            TDF_Label sketch = findFeature(entry.sketchId);
+            ok = !sketch.IsNull() &&
+                 getFeatureId(createExtrude(sketch, entry.height, entry.name)) == entry.featureId;
+            break;
+        }
+        case EditJournal::SetName: {
+            TDF_Label label = findFeature(entry.featureId);
+            ok = !label.IsNull();
+            if (ok) setFeatureName(label, entry.name);
+            break;
+        }
+        case EditJournal::AddPolylines: {
+            TDF_Label sketch = findFeature(entry.featureId);
+            ok = !sketch.IsNull();
+            if (ok) {
+                SketchPolylineSet polylines;
+                polylines.coords = entry.xy;
+                polylines.offsets = entry.offsets;
+                ok = addPolylinesToSketch(sketch, polylines);
+            }
+            break;
+        }
+        }
+        if (!ok) {
+            qWarning() << "Edit journal" << path << "does not match the document";
+            break;
+        }
+    }
+
+    if (!ok) {
+        // Part of a journal rebuilds a document that never existed; go
+        // back to the save instead
+        if (commandOpen) abortCommand();
+        // A copy: loading clears m_sourcePath before it reads the file
+        QString source = m_sourcePath;
+        bool restored = source.isEmpty() ? newDocument() : loadDocument(source, m_loadMode);
+        if (!restored) qWarning() << "Cannot restore" << source << "after a failed recovery";
+        return false;
+    }
+
+    // Edits of the command that was in progress at the crash are kept
+    if (commandOpen) commitCommand();
+    return true;
+}
+
+bool OcafDocument::readDeferred(const QVector<TDF_Label>& labels) const {
+    if (m_unloaded.isEmpty() || m_sourcePath.isEmpty()) return true;
+
+    Handle(PCDM_ReaderFilter) filter = new PCDM_ReaderFilter(PCDM_ReaderFilter::AppendMode_Protect);
+    QVector<int> ids;
+    for (const TDF_Label& label : labels) {
+        int id = getFeatureId(label);
+        if (!m_unloaded.contains(id) || ids.contains(id)) continue;
+
+        TCollection_AsciiString entry;
+        TDF_Tool::Entry(label, entry);
+        filter->AddPath(entry);
+        ids.append(id);
+    }
+    if (ids.isEmpty()) return true;
+
+    // Append mode keeps the document and only adds attributes it lacks,
+    // so edits made since the lazy load are not overwritten
+    Handle(TDocStd_Document) doc = m_doc;
+    TCollection_ExtendedString path(m_sourcePath.toStdWString().c_str());
+    if (m_app->Open(path, doc, filter) != PCDM_RS_OK) {
+        qWarning() << "Cannot read deferred feature data from" << m_sourcePath;
+        return false;
+    }
+
+    // Only now: features whose data could not be read stay unloaded, so
+    // nothing is written over what the file still holds
+    for (int id : ids) m_unloaded.remove(id);
+    return true;
+}
+
+bool OcafDocument::ensureLoaded(TDF_Label label) const {
+    if (m_unloaded.isEmpty() || label.IsNull()) return true;
+    if (!m_unloaded.contains(getFeatureId(label))) return true;
+
+    return readDeferred(QVector<TDF_Label>() << label);
+}
+
+bool OcafDocument::materialize(const QVector<TDF_Label>& labels) {
+    QVector<TDF_Label> extrudes;
+    for (const TDF_Label& label : labels) {
+        if (m_unloaded.contains(getFeatureId(label)) && getFeatureType(label) == FeatureType::Extrude) {
+            extrudes.append(label);
+        }
+    }
+
+    if (!readDeferred(labels)) return false;
+
+    for (const TDF_Label& label : extrudes) {
+        if (!label.IsAttribute(TNaming_NamedShape::GetID())) {
+            m_graph.markDirty(getFeatureId(label));
+        }
+    }
+    return true;
+}
+
+bool OcafDocument::isMaterialized(TDF_Label label) const {
+    return !m_unloaded.contains(getFeatureId(label));
+}
+
+void OcafDocument::requeueStripped(const QSet<int>* touched) {
+    if (m_sourcePath.isEmpty()) return;
+
+    // Deferred data read inside a transaction is removed again when that
+    // transaction is undone or aborted; the file still has it
+    for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+        if (touched && !touched->contains(it.key())) continue;
+
+        FeatureType type = getFeatureType(it.value());
+        if ((type == FeatureType::Sketch && !it.value().IsAttribute(SketchGeometryAttribute::GetID())) ||
+            (type == FeatureType::Extrude && !it.value().IsAttribute(TNaming_NamedShape::GetID()))) {
+            m_unloaded.insert(it.key());
+        }
+    }
+}
+
+void OcafDocument::rebuildFeatureIndex() {
+    m_featureIndex.clear();
 
     int maxId = 0;
     for (TDF_ChildIterator it(getRootLabel()); it.More(); it.Next()) {
         int id = getFeatureId(it.Value());
+        if (id < 0) continue;
+
+        m_featureIndex.insert(id, it.Value());
         if (id > maxId) maxId = id;
     }
-    m_nextFeatureId = maxId + 1;
 
+    // Never hand out an ID that is still reachable through redo
+    if (maxId + 1 > m_nextFeatureId) {
+        m_nextFeatureId = maxId + 1;
+    }
+}
+
+void OcafDocument::rebuildGraph(const QSet<int>* touched) {
+    QSet<int> wasDirty;
+    if (touched) {
+        for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+            if (m_graph.isDirty(it.key())) wasDirty.insert(it.key());
+        }
+    }
+
+    m_graph.clear();
+    for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+        m_graph.addNode(it.key());
+    }
+
+    for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+        if (getFeatureType(it.value()) != FeatureType::Extrude) continue;
+
+        Handle(TDataStd_Integer) sketchIdAttr;
+        if (it.value().FindAttribute(GUID_EXTRUDE_SKETCH, sketchIdAttr)) {
+            m_graph.addDependency(it.key(), sketchIdAttr->Get());
+        }
+    }
+
+    if (!touched) {
+        m_graph.markAllDirty();
+        return;
+    }
+
+    // addNode marks everything dirty; keep only what was dirty before plus
+    // the features the transaction touched
+    for (auto it = m_featureIndex.constBegin(); it != m_featureIndex.constEnd(); ++it) {
+        if (!wasDirty.contains(it.key())) m_graph.clearDirty(it.key());
+    }
+    for (int id : wasDirty) m_graph.markDirty(id);
+    for (int id : *touched) m_graph.markDirty(id);
+}
+
+QVector<TDF_Label> OcafDocument::featureLabelsInDelta(const Handle(TDF_Delta)& delta) const {
+    QVector<TDF_Label> labels;
+    if (delta.IsNull()) return labels;
+
+    TDF_Label root = getRootLabel();
+    for (TDF_ListIteratorOfAttributeDeltaList it(delta->AttributeDeltas()); it.More(); it.Next()) {
+        TDF_Label label = it.Value()->Label();
+        while (!label.IsNull() && !label.IsRoot() && !label.Father().IsEqual(root)) {
+            label = label.Father();
+        }
+        if (!label.IsNull() && !label.IsRoot() && !labels.contains(label)) {
+            labels.append(label);
+        }
+    }
+    return labels;
+}
+
+bool OcafDocument::verifyFeatureIndex() const {
+    int count = 0;
+    for (TDF_ChildIterator it(getRootLabel()); it.More(); it.Next()) {
+        int id = getFeatureId(it.Value());
+        if (id < 0) continue;
+
+        if (!m_featureIndex.contains(id) || !m_featureIndex.value(id).IsEqual(it.Value())) {
+            qWarning() << "Feature index out of sync for feature" << id;
+            return false;
+        }
+        ++count;
+    }
+
+    if (count != m_featureIndex.size()) {
+        qWarning() << "Feature index holds" << m_featureIndex.size()
+                   << "entries but the document has" << count << "features";
+        return false;
+    }
+    return true;
+}
+
+void OcafDocument::openCommand() {
+    if (m_doc.IsNull()) return;
+    m_doc->OpenCommand();
+    m_journal.logCommand(EditJournal::OpenCommand);
+}
+
+void OcafDocument::commitCommand() {
+    if (m_doc.IsNull()) return;
+    int undos = m_doc->GetUndos().Extent();
+    // At the undo limit the oldest step drops off, and with it one of
+    // the steps below the floor
+    if (m_doc->CommitCommand() && m_doc->GetUndos().Extent() == undos) {
+        if (m_undoFloor > 0) --m_undoFloor;
+        if (m_pendingUndoFloor > 0) --m_pendingUndoFloor;
+    }
+    m_journal.logCommand(EditJournal::CommitCommand);
+    m_journal.sync();
+}
+
+void OcafDocument::abortCommand() {
+    if (m_doc.IsNull()) return;
+    m_doc->AbortCommand();
+    m_journal.logCommand(EditJournal::AbortCommand);
+    m_journal.sync();
+    rebuildFeatureIndex();
+    Q_ASSERT(verifyFeatureIndex());
+    rebuildGraph();
+    requeueStripped(nullptr);
+}
+
+bool OcafDocument::undo() {
+    if (!canUndo()) return false;
+
+    // Resolve the touched features on both sides of the delta: a feature
+    // created by the transaction only has an ID before it is undone
+    QVector<TDF_Label> labels = featureLabelsInDelta(m_doc->GetUndos().Last());
+    QSet<int> touched;
+    for (const TDF_Label& label : labels) touched.insert(getFeatureId(label));
+
+    if (!m_doc->Undo()) return false;
+    m_journal.logCommand(EditJournal::Undo);
+    m_journal.sync();
+
+    for (const TDF_Label& label : labels) touched.insert(getFeatureId(label));
+    touched.remove(-1);
+
+    rebuildFeatureIndex();
+    Q_ASSERT(verifyFeatureIndex());
+    rebuildGraph(&touched);
+    requeueStripped(&touched);
+    return true;
+}
+
+bool OcafDocument::redo() {
+    if (!canRedo()) return false;
+
+    QVector<TDF_Label> labels = featureLabelsInDelta(m_doc->GetRedos().First());
+    QSet<int> touched;
+    for (const TDF_Label& label : labels) touched.insert(getFeatureId(label));
+
+    if (!m_doc->Redo()) return false;
+    m_journal.logCommand(EditJournal::Redo);
+    m_journal.sync();
+
+    for (const TDF_Label& label : labels) touched.insert(getFeatureId(label));
+    touched.remove(-1);
+
+    rebuildFeatureIndex();
+    Q_ASSERT(verifyFeatureIndex());
+    rebuildGraph(&touched);
+    requeueStripped(&touched);
     return true;
 }
 
+bool OcafDocument::canUndo() const {
+    return !m_doc.IsNull() && !inBatch() && m_doc->GetUndos().Extent() > undoFloor();
+}
+
+bool OcafDocument::canRedo() const {
+    return !m_doc.IsNull() && !inBatch() && !m_doc->GetRedos().IsEmpty();
+}
+
+void OcafDocument::beginBatch() {
+    if (m_doc.IsNull()) return;
+    if (m_batchDepth++ > 0) return;
+
+    m_batchAborted = false;
+    openCommand();
+}
+
+bool OcafDocument::endBatch() {
+    if (m_batchDepth == 0) {
+        qWarning() << "endBatch without beginBatch";
+        return true;
+    }
+    if (--m_batchDepth > 0) return true;
+
+    bool aborted = m_batchAborted;
+    m_batchAborted = false;
+    if (aborted) {
+        abortCommand();
+    } else {
+        commitCommand();
+    }
+    return !aborted;
+}
+
+bool OcafDocument::abortBatch() {
+    if (m_batchDepth == 0) {
+        qWarning() << "abortBatch without beginBatch";
+        return true;
+    }
+    m_batchAborted = true;
+    return endBatch();
+}
+
 TDF_Label OcafDocument::getRootLabel() const {
     if (m_doc.IsNull()) return TDF_Label();
     return m_doc->Main();
@@ -129,7 +606,10 @@ TDF_Label OcafDocument::createFeatureLabel(const QString& name, FeatureType type
 
     TDataStd_Name::Set(newLabel, TCollection_ExtendedString(name.toStdWString().c_str()));
     TDataStd_Integer::Set(newLabel, GUID_FEATURE_TYPE, static_cast<int>(type));
-    TDataStd_Integer::Set(newLabel, GUID_FEATURE_ID, getNextFeatureId());
+    int id = getNextFeatureId();
+    TDataStd_Integer::Set(newLabel, GUID_FEATURE_ID, id);
+    m_featureIndex.insert(id, newLabel);
+    m_graph.addNode(id);
 
     return newLabel;
 }
@@ -137,6 +617,7 @@ TDF_Label OcafDocument::createFeatureLabel(const QString& name, FeatureType type
 TDF_Label OcafDocument::createSketch(const CustomPlane& plane, const QString& name) {
     TDF_Label sketchLabel = createFeatureLabel(name, FeatureType::Sketch);
     savePlaneToLabel(sketchLabel, plane);
+    m_journal.logCreateSketch(getFeatureId(sketchLabel), plane, name);
     return sketchLabel;
 }
 
@@ -160,6 +641,8 @@ void OcafDocument::savePlaneToLabel(TDF_Label label, const CustomPlane& plane) {
     vaxis->SetValue(0, plane.vAxis.x());
     vaxis->SetValue(1, plane.vAxis.y());
     vaxis->SetValue(2, plane.vAxis.z());
+
+    m_graph.markDirty(getFeatureId(label));
 }
 
 CustomPlane OcafDocument::loadPlaneFromLabel(TDF_Label label) const {
@@ -193,21 +676,46 @@ TDF_Label OcafDocument::createExtrude(TDF_Label sketchLabel, double height, cons
 
     TDataStd_Real::Set(extrudeLabel, GUID_EXTRUDE_HEIGHT, height);
     TDataStd_Integer::Set(extrudeLabel, GUID_EXTRUDE_SKETCH, getFeatureId(sketchLabel));
+    m_graph.addDependency(getFeatureId(extrudeLabel), getFeatureId(sketchLabel));
+    m_journal.logCreateExtrude(getFeatureId(extrudeLabel), getFeatureId(sketchLabel), height, name);
 
     return extrudeLabel;
 }
 
-void OcafDocument::addPolylineToSketch(TDF_Label sketchLabel, const QVector<QVector2D>& points) {
-    TDF_Label polylineLabel = TDF_TagSource::NewChild(sketchLabel);
-
+bool OcafDocument::addPolylineToSketch(TDF_Label sketchLabel, const QVector<QVector2D>& points) {
     int numPoints = points.size();
-    Handle(TDataStd_RealArray) coords = TDataStd_RealArray::Set(
-        polylineLabel, GUID_POLYLINES, 0, numPoints * 2 - 1);
+    if (numPoints == 0) return true;
 
+    QVector<double> coords(numPoints * 2);
     for (int i = 0; i < numPoints; ++i) {
-        coords->SetValue(i * 2, points[i].x());
-        coords->SetValue(i * 2 + 1, points[i].y());
+        coords[i * 2] = points[i].x();
+        coords[i * 2 + 1] = points[i].y();
     }
+
+    return addPolylineToSketch(sketchLabel, coords.constData(), numPoints);
+}
+
+bool OcafDocument::addPolylineToSketch(TDF_Label sketchLabel, const double* xy, int numPoints) {
+    if (numPoints <= 0) return true;
+
+    // Appending to an attribute that was never read would hide the stored one
+    if (!ensureLoaded(sketchLabel)) return false;
+    SketchGeometryAttribute::Set(sketchLabel)->appendPolyline(xy, numPoints);
+    m_journal.logAddPolyline(getFeatureId(sketchLabel), xy, numPoints);
+
+    m_graph.markDirty(getFeatureId(sketchLabel));
+    return true;
+}
+
+bool OcafDocument::addPolylinesToSketch(TDF_Label sketchLabel, const SketchPolylineSet& polylines) {
+    if (polylines.polylineCount() == 0) return true;
+
+    if (!ensureLoaded(sketchLabel)) return false;
+    SketchGeometryAttribute::Set(sketchLabel)->appendPolylines(polylines);
+    m_journal.logAddPolylines(getFeatureId(sketchLabel), polylines);
+
+    m_graph.markDirty(getFeatureId(sketchLabel));
+    return true;
 }
 
 QVector<TDF_Label> OcafDocument::getFeatures() const {
@@ -221,6 +729,10 @@ QVector<TDF_Label> OcafDocument::getFeatures() const {
     return features;
 }
 
+TDF_Label OcafDocument::findFeature(int featureId) const {
+    return m_featureIndex.value(featureId);
+}
+
 FeatureType OcafDocument::getFeatureType(TDF_Label label) const {
     Handle(TDataStd_Integer) typeAttr;
     if (label.FindAttribute(GUID_FEATURE_TYPE, typeAttr)) {
@@ -238,6 +750,11 @@ QString OcafDocument::getFeatureName(TDF_Label label) const {
     return "Unnamed";
 }
 
+void OcafDocument::setFeatureName(TDF_Label label, const QString& name) {
+    TDataStd_Name::Set(label, TCollection_ExtendedString(name.toStdWString().c_str()));
+    m_journal.logSetName(getFeatureId(label), name);
+}
+
 int OcafDocument::getFeatureId(TDF_Label label) const {
     Handle(TDataStd_Integer) idAttr;
     if (label.FindAttribute(GUID_FEATURE_ID, idAttr)) {
@@ -250,29 +767,46 @@ CustomPlane OcafDocument::getSketchPlane(TDF_Label sketchLabel) const {
     return loadPlaneFromLabel(sketchLabel);
 }
 
-QVector<QVector<QVector2D>> OcafDocument::getSketchPolylines(TDF_Label sketchLabel) const {
-    QVector<QVector<QVector2D>> polylines;
-
-    for (TDF_ChildIterator it(sketchLabel); it.More(); it.Next()) {
-        TDF_Label polylineLabel = it.Value();
-        Handle(TDataStd_RealArray) coords;
+Handle(SketchGeometryAttribute) OcafDocument::getSketchGeometry(TDF_Label sketchLabel) const {
+    Handle(SketchGeometryAttribute) geometry;
+    if (!sketchLabel.IsNull()) {
+        ensureLoaded(sketchLabel);
+        sketchLabel.FindAttribute(SketchGeometryAttribute::GetID(), geometry);
+    }
+    return geometry;
+}
 
-        if (polylineLabel.FindAttribute(GUID_POLYLINES, coords)) {
-            QVector<QVector2D> points;
-            int numCoords = coords->Upper() - coords->Lower() + 1;
-            int numPoints = numCoords / 2;
+SketchPolylineSet OcafDocument::getSketchPolylines(TDF_Label sketchLabel) const {
+    Handle(SketchGeometryAttribute) geometry = getSketchGeometry(sketchLabel);
+    if (geometry.IsNull()) return SketchPolylineSet();
+    return geometry->polylines();
+}
 
-            for (int i = 0; i < numPoints; ++i) {
-                double x = coords->Value(i * 2);
-                double y = coords->Value(i * 2 + 1);
-                points.append(QVector2D(x, y));
+void OcafDocument::convertLegacyPolylines() {
+    for (TDF_ChildIterator feature(getRootLabel()); feature.More(); feature.Next()) {
+        TDF_Label sketchLabel = feature.Value();
+        if (getFeatureType(sketchLabel) != FeatureType::Sketch) continue;
+        if (!getSketchGeometry(sketchLabel).IsNull()) continue;
+
+        Handle(SketchGeometryAttribute) geometry;
+        for (TDF_ChildIterator it(sketchLabel); it.More(); it.Next()) {
+            TDF_Label polylineLabel = it.Value();
+            Handle(TDataStd_RealArray) coords;
+            if (!polylineLabel.FindAttribute(GUID_POLYLINES, coords)) continue;
+
+            int numPoints = (coords->Upper() - coords->Lower() + 1) / 2;
+            QVector<double> xy(numPoints * 2);
+            for (int i = 0; i < numPoints * 2; ++i) {
+                xy[i] = coords->Value(coords->Lower() + i);
             }
 
-            polylines.append(points);
+            if (geometry.IsNull()) geometry = SketchGeometryAttribute::Set(sketchLabel);
+            geometry->appendPolyline(xy.constData(), numPoints);
+
+            // The emptied child label is no longer written on save
+            polylineLabel.ForgetAllAttributes();
         }
     }
-
-    return polylines;
 }
 
 double OcafDocument::getExtrudeHeight(TDF_Label extrudeLabel) const {
@@ -286,18 +820,13 @@ double OcafDocument::getExtrudeHeight(TDF_Label extrudeLabel) const {
 TDF_Label OcafDocument::getExtrudeSketch(TDF_Label extrudeLabel) const {
     Handle(TDataStd_Integer) sketchIdAttr;
     if (extrudeLabel.FindAttribute(GUID_EXTRUDE_SKETCH, sketchIdAttr)) {
-        int sketchId = sketchIdAttr->Get();
-
-        for (TDF_ChildIterator it(getRootLabel()); it.More(); it.Next()) {
-            if (getFeatureId(it.Value()) == sketchId) {
-                return it.Value();
-            }
-        }
+        return findFeature(sketchIdAttr->Get());
     }
     return TDF_Label();
 }
 
 TopoDS_Shape OcafDocument::getShape(TDF_Label label) const {
+    ensureLoaded(label);
     Handle(TNaming_NamedShape) namedShape;
     if (label.FindAttribute(TNaming_NamedShape::GetID(), namedShape)) {
         return namedShape->Get();
@@ -309,15 +838,3 @@ void OcafDocument::setShape(TDF_Label label, const TopoDS_Shape& shape) {
     TNaming_Builder builder(label);
     builder.Generated(shape);
 }
-
-void OcafDocument::updateVisualization(TDF_Label label, const Handle(AIS_InteractiveContext)& context) {
-    if (context.IsNull()) return;
-
-    Handle(TPrsStd_AISPresentation) prs;
-    if (!label.FindAttribute(TPrsStd_AISPresentation::GetID(), prs)) {
-        prs = TPrsStd_AISPresentation::Set(label, TNaming_NamedShape::GetID());
-    }
-
-    prs->Display(Standard_True);
-    context->UpdateCurrentViewer();
-}
@@ -4,13 +4,13 @@
 #include <TDocStd_Document.hxx>
 #include <TDocStd_Application.hxx>
 #include <TDF_Label.hxx>
+#include <TDF_Delta.hxx>
 #include <TDataStd_Name.hxx>
 #include <TDataStd_Integer.hxx>
 #include <TDataStd_Real.hxx>
 #include <TNaming_Builder.hxx>
 #include <TNaming_NamedShape.hxx>
-#include <TPrsStd_AISPresentation.hxx>
-#include <XCAFApp_Application.hxx>
+#include <PCDM_ReaderFilter.hxx>
 
 #include <TopoDS_Shape.hxx>
 #include <gp_Pnt.hxx>
@@ -18,33 +18,32 @@
 #include <gp_Ax2.hxx>
 #include <gp_Pln.hxx>
 
-#include <AIS_InteractiveContext.hxx>
-
 #include <QString>
 #include <QVector>
 #include <QVector2D>
 #include <QVector3D>
+#include <QHash>
+#include <QSet>
 #include <memory>
 
+#include "CustomPlane.h"
+#include "EditJournal.h"
+#include "FeatureGraph.h"
+#include "SketchGeometryAttribute.h"
+
 enum class FeatureType {
     Sketch,
     Extrude,
     Root
 };
 
-struct CustomPlane {
-    QVector3D origin;
-    QVector3D normal;
-    QVector3D uAxis;
-    QVector3D vAxis;
-
-    static CustomPlane XY();
-    static CustomPlane XZ();
-    static CustomPlane YZ();
-    QString getDisplayName() const;
-
-    gp_Pln toGpPln() const;
-    gp_Ax2 toGpAx2() const;
+enum class LoadMode {
+    // Everything is read and every feature is marked for regeneration
+    Full,
+    // Only names, types, IDs, planes and references are read. Sketch
+    // geometry and stored shapes stay in the file until a feature is
+    // materialized or one of its getters needs them.
+    Lazy
 };
 
 class OcafDocument {
@@ -54,22 +53,59 @@ public:
 
     bool newDocument();
     bool saveDocument(const QString& filename);
-    bool loadDocument(const QString& filename);
+    bool loadDocument(const QString& filename, LoadMode mode = LoadMode::Full);
+
+    // Pieces of saveDocument and loadDocument for running the file I/O on
+    // another thread. Each job uses its own application from
+    // createApplication, so it shares no OCAF state with this document.
+    static Handle(TDocStd_Application) createApplication();
+    static Handle(PCDM_ReaderFilter) readerFilter(LoadMode mode);
+    // Copy of the label tree in a new document of app, for writing while
+    // editing goes on. Sketch buffers are shared with the copy.
+    Handle(TDocStd_Document) snapshot(const Handle(TDocStd_Application)& app);
+    // Records that the document is now stored in filename; moves the edit
+    // journal next to it, keeping the edits made since the snapshot
+    void markSaved(const QString& filename);
+    // Forgets the snapshot of a save that failed or was cancelled
+    void discardSnapshot();
+    // Replaces the current document with doc, opened by app from filename
+    // with readerFilter(mode)
+    bool adoptDocument(const Handle(TDocStd_Application)& app,
+                       const Handle(TDocStd_Document)& doc,
+                       const QString& filename, LoadMode mode);
+
+    // Reads the deferred attributes of the given features in one pass over
+    // the file. Extrudes without a stored shape are marked dirty. False if
+    // the file cannot be read; the features then stay unloaded.
+    bool materialize(const QVector<TDF_Label>& labels);
+    bool isMaterialized(TDF_Label label) const;
+    bool hasUnloadedFeatures() const { return !m_unloaded.isEmpty(); }
 
     TDF_Label createSketch(const CustomPlane& plane, const QString& name);
     TDF_Label createExtrude(TDF_Label sketchLabel, double height, const QString& name);
 
-    void addPolylineToSketch(TDF_Label sketchLabel, const QVector<QVector2D>& points);
+    // False, and nothing is appended, when the sketch's stored geometry
+    // cannot be read from its file
+    bool addPolylineToSketch(TDF_Label sketchLabel, const QVector<QVector2D>& points);
+    // xy holds numPoints interleaved x/y pairs
+    bool addPolylineToSketch(TDF_Label sketchLabel, const double* xy, int numPoints);
+    // Appends many polylines with one attribute update and one journal record
+    bool addPolylinesToSketch(TDF_Label sketchLabel, const SketchPolylineSet& polylines);
 
     TDF_Label getRootLabel() const;
     QVector<TDF_Label> getFeatures() const;
+    TDF_Label findFeature(int featureId) const;
 
     FeatureType getFeatureType(TDF_Label label) const;
     QString getFeatureName(TDF_Label label) const;
+    void setFeatureName(TDF_Label label, const QString& name);
     int getFeatureId(TDF_Label label) const;
 
     CustomPlane getSketchPlane(TDF_Label sketchLabel) const;
-    QVector<QVector<QVector2D>> getSketchPolylines(TDF_Label sketchLabel) const;
+    // Shares the stored buffers; copying the result allocates nothing
+    SketchPolylineSet getSketchPolylines(TDF_Label sketchLabel) const;
+    // Packed polylines of the sketch, null when it has none yet
+    Handle(SketchGeometryAttribute) getSketchGeometry(TDF_Label sketchLabel) const;
 
     double getExtrudeHeight(TDF_Label extrudeLabel) const;
     TDF_Label getExtrudeSketch(TDF_Label extrudeLabel) const;
@@ -77,19 +113,89 @@ public:
     TopoDS_Shape getShape(TDF_Label label) const;
     void setShape(TDF_Label label, const TopoDS_Shape& shape);
 
-    void updateVisualization(TDF_Label label, const Handle(AIS_InteractiveContext)& context);
-
     Handle(TDocStd_Document) getDocument() const { return m_doc; }
 
     int getNextFeatureId() { return m_nextFeatureId++; }
 
+    void openCommand();
+    void commitCommand();
+    void abortCommand();
+    bool undo();
+    bool redo();
+    bool canUndo() const;
+    bool canRedo() const;
+
+    // Groups every edit up to the matching endBatch into one undo step.
+    // Batches nest; only the outermost one opens and commits the OCAF
+    // command. abortBatch closes one level and discards the whole
+    // outermost batch when it ends. Both return false when this call
+    // discarded the batch.
+    void beginBatch();
+    bool endBatch();
+    bool abortBatch();
+    bool inBatch() const { return m_batchDepth > 0; }
+
+    // Edit journal: the edits made since the last full save, logged next
+    // to the document so a crash loses at most the command in progress.
+    // Not started by default; replay before starting, as starting without
+    // keep discards what the journal holds. While it runs, undo stops at
+    // the save the journal is based on: a loaded document has no undo
+    // history, so an undo of an older command could not be replayed.
+    static QString journalPath(const QString& documentPath);
+    // Edits in the journal at path that apply to this document's save
+    int journalEditCount(const QString& path) const;
+    // On a mismatch the document is restored to its save and false is
+    // returned
+    bool replayJournal(const QString& path);
+    bool startJournal(const QString& path, bool keep);
+    void stopJournal();
+
+    // Walks the label tree and checks it against the feature index.
+    bool verifyFeatureIndex() const;
+
+    FeatureGraph& graph() { return m_graph; }
+    const FeatureGraph& graph() const { return m_graph; }
+
 private:
     Handle(TDocStd_Application) m_app;
     Handle(TDocStd_Document) m_doc;
 
     int m_nextFeatureId;
 
+    // Feature ID -> root child label, kept in sync with the label tree
+    QHash<int, TDF_Label> m_featureIndex;
+
+    // Feature dependencies and dirty state for regeneration
+    FeatureGraph m_graph;
+
+    int m_batchDepth;
+    bool m_batchAborted;
+
+    // Lazy loading: the file the document came from and the features
+    // whose deferred attributes have not been read from it yet
+    QString m_sourcePath;
+    LoadMode m_loadMode;
+    mutable QSet<int> m_unloaded;
+
+    EditJournal m_journal;
+    // Journal position when the document was last snapshotted for saving
+    qint64 m_savedJournalPos;
+    // Undo steps that predate the journal's save, and those that predate
+    // a pending snapshot (-1 for none); undo does not go below them
+    int m_undoFloor;
+    int m_pendingUndoFloor;
+
+    int undoFloor() const;
+
+    void closeDocument();
     TDF_Label createFeatureLabel(const QString& name, FeatureType type);
+    void rebuildFeatureIndex();
+    void rebuildGraph(const QSet<int>* touched = nullptr);
+    void convertLegacyPolylines();
+    bool ensureLoaded(TDF_Label label) const;
+    bool readDeferred(const QVector<TDF_Label>& labels) const;
+    void requeueStripped(const QSet<int>* touched);
+    QVector<TDF_Label> featureLabelsInDelta(const Handle(TDF_Delta)& delta) const;
     void savePlaneToLabel(TDF_Label label, const CustomPlane& plane);
     CustomPlane loadPlaneFromLabel(TDF_Label label) const;
 };
@@ -0,0 +1,49 @@
+#include "PartialFile.h"
+
+#include <QFile>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+namespace {
+    // The rename must not reach the disk before the data it points to
+    bool syncToDisk(const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadWrite)) return false;
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return ::fsync(file.handle()) == 0;
+#endif
+    }
+
+    bool replaceFile(const QString& from, const QString& to) {
+#ifdef Q_OS_WIN
+        return MoveFileExW(reinterpret_cast<const wchar_t*>(from.utf16()),
+                           reinterpret_cast<const wchar_t*>(to.utf16()),
+                           MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return std::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+    }
+}
+
+QString PartialFile::path(const QString& target) {
+    return target + ".part";
+}
+
+bool PartialFile::commit(const QString& target) {
+    QString partial = path(target);
+    if (syncToDisk(partial) && replaceFile(partial, target)) return true;
+    QFile::remove(partial);
+    return false;
+}
+
+void PartialFile::discard(const QString& target) {
+    QFile::remove(path(target));
+}
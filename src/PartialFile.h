@@ -0,0 +1,22 @@
+#ifndef PARTIALFILE_H
+#define PARTIALFILE_H
+
+#include <QString>
+
+// Replace-on-completion for writers that take a file name rather than a
+// QIODevice, so QSaveFile cannot be used: OCAF storage and the OCCT
+// translators. The writer fills path(target); commit then moves it over
+// target in one rename, so target always holds either the old or the
+// complete new file.
+class PartialFile {
+public:
+    static QString path(const QString& target);
+
+    // Flushes the partial file to disk and atomically replaces target
+    // with it. On failure target is untouched and the partial file is
+    // removed.
+    static bool commit(const QString& target);
+    static void discard(const QString& target);
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "Regenerator.h"
+#include "FeatureBuilder.h"
+
+#include <OSD_Parallel.hxx>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QDebug>
+
+#include <algorithm>
+
+// Builds one job per call; jobs own disjoint data so no locking is needed
+struct Regenerator::BuildFunctor {
+    QVector<BuildJob>* jobs;
+
+    void operator()(int threadIndex, int jobIndex) const {
+        (void)threadIndex;
+        BuildJob& job = (*jobs)[jobIndex];
+        if (job.cached) return;
+
+        QElapsedTimer timer;
+        timer.start();
+        job.result = FeatureBuilder::makeExtrude(job.polylines, job.plane, job.height);
+        job.milliseconds = timer.nsecsElapsed() / 1.0e6;
+    }
+};
+
+Regenerator::Regenerator() : m_document(nullptr), m_threadCount(0) {
+}
+
+void Regenerator::setThreadCount(int threads) {
+    m_threadCount = qMax(0, threads);
+    m_pool.Nullify();
+    if (m_threadCount > 1) {
+        m_pool = new OSD_ThreadPool(m_threadCount);
+    }
+}
+
+QVector<TDF_Label> Regenerator::regenerate() {
+    if (!m_document) return QVector<TDF_Label>();
+    return evaluate(m_document->graph().dirtyInOrder());
+}
+
+QVector<TDF_Label> Regenerator::regenerateFeature(TDF_Label label) {
+    if (!m_document || label.IsNull()) return QVector<TDF_Label>();
+    return evaluate(m_document->graph().dirtyCone(m_document->getFeatureId(label)));
+}
+
+QVector<TDF_Label> Regenerator::evaluate(const QVector<int>& order) {
+    QVector<TDF_Label> rebuilt;
+    FeatureGraph& graph = m_document->graph();
+    m_timings.clear();
+
+    // order is topological, so one pass assigns every feature a level one
+    // above its deepest dirty upstream
+    QHash<int, int> levels;
+    int maxLevel = 0;
+    for (int id : order) {
+        int level = 0;
+        for (int up : graph.upstream(id)) {
+            if (levels.contains(up)) level = qMax(level, levels.value(up) + 1);
+        }
+        levels.insert(id, level);
+        maxLevel = qMax(maxLevel, level);
+    }
+
+    for (int level = 0; level <= maxLevel; ++level) {
+        QVector<BuildJob> jobs;
+
+        for (int id : order) {
+            if (levels.value(id) != level) continue;
+
+            TDF_Label label = m_document->findFeature(id);
+            graph.clearDirty(id);
+            if (label.IsNull()) continue;
+
+            // Sketches carry their geometry directly; only extrudes own a shape
+            if (m_document->getFeatureType(label) != FeatureType::Extrude) {
+                rebuilt.append(label);
+                continue;
+            }
+
+            TDF_Label sketchLabel = m_document->getExtrudeSketch(label);
+            if (sketchLabel.IsNull()) {
+                qWarning() << "Extrude feature" << id << "references invalid sketch";
+                FeatureTiming timing = { id, 0.0, false, false };
+                m_timings.append(timing);
+                continue;
+            }
+
+            BuildJob job;
+            job.label = label;
+            job.plane = m_document->getSketchPlane(sketchLabel);
+            job.polylines = m_document->getSketchPolylines(sketchLabel);
+            job.height = m_document->getExtrudeHeight(label);
+            job.key = ShapeCache::extrudeKey(job.plane, job.polylines, job.height);
+            job.result = m_cache.find(job.key);
+            job.cached = !job.result.IsNull();
+            job.milliseconds = 0.0;
+            jobs.append(job);
+        }
+
+        buildJobs(jobs);
+
+        for (const BuildJob& job : jobs) {
+            int id = m_document->getFeatureId(job.label);
+            FeatureTiming timing = { id, job.milliseconds, job.cached, !job.result.IsNull() };
+            m_timings.append(timing);
+
+            if (job.result.IsNull()) {
+                qWarning() << "Regeneration failed for feature" << id;
+                continue;
+            }
+            if (!job.cached) {
+                m_cache.insert(job.key, job.result);
+            }
+            // Leave the document untouched when the stored shape is current
+            if (!m_document->getShape(job.label).IsSame(job.result)) {
+                m_document->setShape(job.label, job.result);
+            }
+            rebuilt.append(job.label);
+        }
+    }
+
+    return rebuilt;
+}
+
+void Regenerator::buildJobs(QVector<BuildJob>& jobs) {
+    if (jobs.isEmpty()) return;
+
+    BuildFunctor functor;
+    functor.jobs = &jobs;
+
+    int pending = 0;
+    for (const BuildJob& job : jobs) {
+        if (!job.cached) ++pending;
+    }
+    if (pending == 0) return;
+
+    if (m_threadCount == 1 || pending == 1) {
+        for (int i = 0; i < jobs.size(); ++i) functor(0, i);
+        return;
+    }
+
+    const Handle(OSD_ThreadPool)& pool = m_pool.IsNull() ? OSD_ThreadPool::DefaultPool() : m_pool;
+    OSD_ThreadPool::Launcher launcher(*pool, m_threadCount > 1 ? m_threadCount : -1);
+    launcher.Perform(0, jobs.size(), functor);
+}
+
+QVector<TopoDS_Shape> Regenerator::makeSketchWires(const OcafDocument& doc, TDF_Label sketchLabel) {
+    QVector<TopoDS_Shape> wires;
+    if (sketchLabel.IsNull()) return wires;
+
+    CustomPlane plane = doc.getSketchPlane(sketchLabel);
+    SketchPolylineSet polylines = doc.getSketchPolylines(sketchLabel);
+    wires.reserve(polylines.polylineCount());
+    for (int k = 0; k < polylines.polylineCount(); ++k) {
+        TopoDS_Shape wire = FeatureBuilder::makePolyline(polylines.polyline(k), plane);
+        if (!wire.IsNull()) wires.append(wire);
+    }
+    return wires;
+}
+
+TopoDS_Shape Regenerator::makeExtrude(const OcafDocument& doc, TDF_Label extrudeLabel) {
+    TDF_Label sketchLabel = doc.getExtrudeSketch(extrudeLabel);
+    if (sketchLabel.IsNull()) return TopoDS_Shape();
+
+    return FeatureBuilder::makeExtrude(doc.getSketchPolylines(sketchLabel),
+                                       doc.getSketchPlane(sketchLabel),
+                                       doc.getExtrudeHeight(extrudeLabel));
+}
+
+QString Regenerator::benchmark(int pairs) {
+    OcafDocument doc;
+    doc.newDocument();
+
+    for (int i = 0; i < pairs; ++i) {
+        double x = (i % 100) * 20.0;
+        double y = (i / 100) * 20.0;
+        const double outline[] = { x, y, x + 10, y, x + 10, y + 10, x, y + 10, x, y };
+
+        TDF_Label sketch = doc.createSketch(CustomPlane::XY(), QString("Sketch %1").arg(i));
+        doc.addPolylineToSketch(sketch, outline, 5);
+        doc.createExtrude(sketch, 5.0 + (i % 7), QString("Extrude %1").arg(i));
+    }
+
+    int cores = qMax(1, OSD_Parallel::NbLogicalProcessors());
+    QVector<int> threadCounts;
+    for (int t = 1; t < cores; t *= 2) threadCounts.append(t);
+    threadCounts.append(cores);
+
+    QString report = QString("Regeneration of %1 sketch/extrude pairs\n").arg(pairs);
+    double serialMs = 0.0;
+
+    for (int threads : threadCounts) {
+        Regenerator regen;
+        regen.setDocument(&doc);
+        regen.setThreadCount(threads);
+
+        doc.graph().markAllDirty();
+        QElapsedTimer timer;
+        timer.start();
+        regen.regenerate();
+        double ms = timer.nsecsElapsed() / 1.0e6;
+
+        if (threads == 1) serialMs = ms;
+        report += QString("threads=%1 time=%2 ms speedup=%3x\n")
+                      .arg(threads)
+                      .arg(ms, 0, 'f', 1)
+                      .arg(ms > 0.0 ? serialMs / ms : 0.0, 0, 'f', 2);
+    }
+
+    return report;
+}
@@ -0,0 +1,81 @@
+#ifndef REGENERATOR_H
+#define REGENERATOR_H
+
+#include <TDF_Label.hxx>
+#include <TopoDS_Shape.hxx>
+#include <OSD_ThreadPool.hxx>
+
+#include <QString>
+#include <QVector>
+
+#include "OcafDocument.h"
+#include "ShapeCache.h"
+
+// Re-evaluates dirty features of an OcafDocument in dependency order and
+// stores the results with setShape. Clean features keep their stored shape.
+//
+// Dirty features are grouped into levels whose members do not depend on
+// each other. For each level the inputs are read from OCAF on the calling
+// thread, the shapes are built on a thread pool, and the results are
+// committed back on the calling thread in feature order.
+class Regenerator {
+public:
+    struct FeatureTiming {
+        int featureId;
+        double milliseconds;
+        bool cached;
+        bool ok;
+    };
+
+    Regenerator();
+
+    void setDocument(OcafDocument* doc) { m_document = doc; }
+
+    // 0 uses the shared OCCT pool with all cores, 1 builds serially
+    void setThreadCount(int threads);
+    int threadCount() const { return m_threadCount; }
+
+    ShapeCache& cache() { return m_cache; }
+
+    // Build time of every extrude evaluated by the last regenerate call
+    const QVector<FeatureTiming>& lastTimings() const { return m_timings; }
+
+    // Evaluates every dirty feature; returns the labels that were rebuilt
+    QVector<TDF_Label> regenerate();
+    // Evaluates only what label needs: its dirty upstreams and itself
+    QVector<TDF_Label> regenerateFeature(TDF_Label label);
+
+    // Build straight from the document, bypassing the cache and the
+    // stored shapes; must run on the thread that owns doc. The sketch
+    // gives one wire per polyline, degenerate polylines are skipped.
+    static QVector<TopoDS_Shape> makeSketchWires(const OcafDocument& doc, TDF_Label sketchLabel);
+    static TopoDS_Shape makeExtrude(const OcafDocument& doc, TDF_Label extrudeLabel);
+
+    // Times full regeneration of a synthetic document of sketch/extrude
+    // pairs for 1, 2, 4 ... up to the core count; returns a text report.
+    static QString benchmark(int pairs);
+
+private:
+    struct BuildFunctor;
+    struct BuildJob {
+        TDF_Label label;
+        CustomPlane plane;
+        SketchPolylineSet polylines;
+        double height;
+        QByteArray key;
+        bool cached;
+        double milliseconds;
+        TopoDS_Shape result;
+    };
+
+    QVector<TDF_Label> evaluate(const QVector<int>& order);
+    void buildJobs(QVector<BuildJob>& jobs);
+
+    OcafDocument* m_document;
+    int m_threadCount;
+    Handle(OSD_ThreadPool) m_pool;
+    ShapeCache m_cache;
+    QVector<FeatureTiming> m_timings;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#include "ShapeCache.h"
+
+#include <BinTools.hxx>
+#include <Standard_Version.hxx>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+namespace {
+    // Bump when FeatureBuilder builds different shapes from the same
+    // inputs or the key layout changes
+    const int KeyVersion = 1;
+
+    const qint64 DefaultDiskLimit = qint64(512) * 1024 * 1024;
+
+    // The pointer/length overload is deprecated from Qt 6.4; the
+    // QByteArrayView one exists since 6.3
+    void addBytes(QCryptographicHash& hash, const void* data, int size) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+        hash.addData(QByteArrayView(static_cast<const char*>(data), size));
+#else
+        hash.addData(static_cast<const char*>(data), size);
+#endif
+    }
+
+    template <typename T>
+    void addRaw(QCryptographicHash& hash, const T& value) {
+        addBytes(hash, &value, int(sizeof(T)));
+    }
+
+    void addVector(QCryptographicHash& hash, const QVector3D& v) {
+        addRaw(hash, v.x());
+        addRaw(hash, v.y());
+        addRaw(hash, v.z());
+    }
+}
+
+ShapeCache::ShapeCache(int maxEntries)
+    : m_shapes(maxEntries)
+    , m_diskLimit(DefaultDiskLimit)
+    , m_diskBytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+QByteArray ShapeCache::extrudeKey(const CustomPlane& plane,
+                                  const SketchPolylineSet& polylines,
+                                  double height) {
+    // Hashed straight from the packed buffers; the offsets keep polyline
+    // boundaries part of the key
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addBytes(hash, "extrude", 7);
+    addRaw(hash, KeyVersion);
+    // Entries are written by BinTools in the format of this OCCT version
+    addRaw(hash, int(OCC_VERSION_HEX));
+
+    addVector(hash, plane.origin);
+    addVector(hash, plane.normal);
+    addVector(hash, plane.uAxis);
+    addVector(hash, plane.vAxis);
+    addRaw(hash, height);
+
+    int polylineCount = polylines.polylineCount();
+    addRaw(hash, polylineCount);
+    if (polylineCount > 0) {
+        addBytes(hash, polylines.offsets.constData(), polylines.offsets.size() * int(sizeof(int)));
+        addBytes(hash, polylines.coords.constData(), polylines.coords.size() * int(sizeof(double)));
+    }
+
+    return hash.result();
+}
+
+void ShapeCache::setDiskDirectory(const QString& path) {
+    m_diskDir = path;
+    if (!m_diskDir.isEmpty() && !QDir().mkpath(m_diskDir)) {
+        qWarning() << "Cannot create shape cache directory" << m_diskDir;
+        m_diskDir.clear();
+    }
+    m_diskBytes = 0;
+    trimDisk();
+}
+
+void ShapeCache::setDiskLimit(qint64 bytes) {
+    m_diskLimit = qMax(qint64(0), bytes);
+    trimDisk();
+}
+
+void ShapeCache::trimDisk() {
+    if (m_diskDir.isEmpty()) return;
+
+    // Oldest first; reads and writes refresh the modification time
+    QFileInfoList entries = QDir(m_diskDir).entryInfoList(QStringList() << "*.bbrep", QDir::Files,
+                                                         QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries) total += entry.size();
+
+    // Down to three quarters of the limit, so not every insert rescans
+    if (total > m_diskLimit) {
+        qint64 target = m_diskLimit - m_diskLimit / 4;
+        for (const QFileInfo& entry : entries) {
+            if (total <= target) break;
+            if (QFile::remove(entry.filePath())) total -= entry.size();
+        }
+    }
+    m_diskBytes = total;
+}
+
+QString ShapeCache::diskPath(const QByteArray& key) const {
+    return m_diskDir + "/" + QString::fromLatin1(key.toHex()) + ".bbrep";
+}
+
+TopoDS_Shape ShapeCache::find(const QByteArray& key) {
+    if (TopoDS_Shape* shape = m_shapes.object(key)) {
+        ++m_hits;
+        return *shape;
+    }
+
+    if (!m_diskDir.isEmpty()) {
+        QString path = diskPath(key);
+        if (QFile::exists(path)) {
+            TopoDS_Shape shape;
+            if (BinTools::Read(shape, QFile::encodeName(path).constData()) && !shape.IsNull()) {
+                QFile file(path);
+                if (file.open(QIODevice::ReadWrite)) {
+                    file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+                }
+                m_shapes.insert(key, new TopoDS_Shape(shape));
+                ++m_hits;
+                return shape;
+            }
+            qWarning() << "Discarding unreadable cached shape" << path;
+            QFile::remove(path);
+        }
+    }
+
+    ++m_misses;
+    return TopoDS_Shape();
+}
+
+void ShapeCache::insert(const QByteArray& key, const TopoDS_Shape& shape) {
+    if (shape.IsNull()) return;
+
+    m_shapes.insert(key, new TopoDS_Shape(shape));
+
+    if (!m_diskDir.isEmpty()) {
+        QString path = diskPath(key);
+        if (QFile::exists(path)) return;
+
+        // Write aside and rename so a crash never leaves a truncated entry
+        QString tmpPath = path + ".tmp";
+        if (!BinTools::Write(shape, QFile::encodeName(tmpPath).constData())
+            || !QFile::rename(tmpPath, path)) {
+            qWarning() << "Cannot write cached shape" << path;
+            QFile::remove(tmpPath);
+            return;
+        }
+        m_diskBytes += QFileInfo(path).size();
+        if (m_diskBytes > m_diskLimit) trimDisk();
+    }
+}
+
+void ShapeCache::clear() {
+    m_shapes.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef SHAPECACHE_H
+#define SHAPECACHE_H
+
+#include <TopoDS_Shape.hxx>
+
+#include <QByteArray>
+#include <QCache>
+#include <QString>
+#include <QVector>
+
+#include "CustomPlane.h"
+#include "SketchPolyline.h"
+
+// Content-addressed store of built feature shapes. Keys are hashes of
+// everything a shape is built from, so equal inputs always map to the
+// same entry regardless of which feature or document produced them.
+// Keys also cover the builder and OCCT versions, so shapes from an older
+// build are never returned; they are left to age out of the directory.
+// Entries live in an LRU memory cache and, when a directory is set, are
+// also written there as binary BRep files. The directory is kept under a
+// size limit by removing the files least recently written or read from
+// disk.
+class ShapeCache {
+public:
+    explicit ShapeCache(int maxEntries = 10000);
+
+    static QByteArray extrudeKey(const CustomPlane& plane,
+                                 const SketchPolylineSet& polylines,
+                                 double height);
+
+    // Empty path disables the disk tier
+    void setDiskDirectory(const QString& path);
+    QString diskDirectory() const { return m_diskDir; }
+    void setDiskLimit(qint64 bytes);
+    qint64 diskLimit() const { return m_diskLimit; }
+
+    TopoDS_Shape find(const QByteArray& key);
+    void insert(const QByteArray& key, const TopoDS_Shape& shape);
+    void clear();
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    QString diskPath(const QByteArray& key) const;
+    void trimDisk();
+
+    QCache<QByteArray, TopoDS_Shape> m_shapes;
+    QString m_diskDir;
+    qint64 m_diskLimit;
+    // Bytes in the directory as of the last trim plus what was written since
+    qint64 m_diskBytes;
+    int m_hits;
+    int m_misses;
+};
+
+#endif
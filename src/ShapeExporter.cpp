@@ -0,0 +1,339 @@
+#include "ShapeExporter.h"
+#include "OcafDocument.h"
+#include "PartialFile.h"
+#include "Regenerator.h"
+
+#include <BRep_Builder.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
+#include <BRepTools.hxx>
+#include <IGESCAFControl_Writer.hxx>
+#include <OSD_Parallel.hxx>
+#include <OSD_ThreadPool.hxx>
+#include <STEPCAFControl_Writer.hxx>
+#include <TDataStd_Name.hxx>
+#include <TDocStd_Document.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Compound.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace {
+    TCollection_ExtendedString extendedString(const QString& text) {
+        return TCollection_ExtendedString(text.toStdWString().c_str());
+    }
+
+    // Feature names may hold anything; keep file names portable
+    QString fileNameFor(int id, const QString& name) {
+        QString safe;
+        for (QChar c : name) {
+            safe += (c.isLetterOrNumber() || c == '-' || c == '_') ? c : QChar('_');
+        }
+        return QString("%1_%2.brep").arg(id).arg(safe);
+    }
+
+    // Writes shape to the partial file of path and commits it
+    bool writeBrep(const TopoDS_Shape& shape, const QString& path,
+                   const Message_ProgressRange& progress = Message_ProgressRange()) {
+        // Triangulations added for display are left out; readers re-mesh
+        bool ok = BRepTools::Write(shape, QFile::encodeName(PartialFile::path(path)).constData(),
+                                   Standard_False, Standard_False, TopTools_FormatVersion_CURRENT, progress);
+        if (!ok) {
+            PartialFile::discard(path);
+            return false;
+        }
+        return PartialFile::commit(path);
+    }
+
+    template <typename Functor>
+    void forEachPart(int count, int threads, const Functor& functor) {
+        if (threads == 1 || count < 2) {
+            for (int i = 0; i < count; ++i) functor(0, i);
+        } else {
+            OSD_ThreadPool::Launcher launcher(*OSD_ThreadPool::DefaultPool(), threads);
+            launcher.Perform(0, count, functor);
+        }
+    }
+}
+
+// Writes and commits one part per call into its own file
+struct ShapeExporter::PartWriter {
+    const QVector<Part>* parts;
+    const QVector<QString>* paths;
+    QVector<char>* written;
+
+    void operator()(int threadIndex, int index) const {
+        (void)threadIndex;
+        (*written)[index] = writeBrep((*parts)[index].shape, (*paths)[index]) ? 1 : 0;
+    }
+};
+
+// Copies one part per call; parts only share geometry, which copying
+// reads but does not change
+struct ShapeExporter::PartCopier {
+    QVector<Part>* parts;
+
+    void operator()(int threadIndex, int index) const {
+        (void)threadIndex;
+        Part& part = (*parts)[index];
+        BRepBuilderAPI_Copy copier(part.shape, Standard_False, Standard_False);
+        part.shape = copier.Shape();
+    }
+};
+
+ShapeExporter::ShapeExporter() : m_threadCount(0) {
+}
+
+bool ShapeExporter::formatForPath(const QString& path, Format& format) {
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "step" || suffix == "stp") {
+        format = Step;
+    } else if (suffix == "iges" || suffix == "igs") {
+        format = Iges;
+    } else if (suffix == "brep") {
+        format = Brep;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QVector<ShapeExporter::Part> ShapeExporter::collect(OcafDocument& document, int* missing) const {
+    QVector<TDF_Label> features = document.getFeatures();
+
+    // Deferred shapes in one pass over the file rather than one per getter
+    if (document.hasUnloadedFeatures()) document.materialize(features);
+
+    Regenerator regen;
+    regen.setDocument(&document);
+    regen.setThreadCount(m_threadCount);
+    regen.regenerate();
+
+    if (missing) *missing = 0;
+    QVector<Part> parts;
+    parts.reserve(features.size());
+    for (const TDF_Label& label : features) {
+        if (document.getFeatureType(label) != FeatureType::Extrude) continue;
+
+        Part part;
+        part.shape = document.getShape(label);
+        if (part.shape.IsNull()) {
+            if (missing) ++*missing;
+            continue;
+        }
+        part.id = document.getFeatureId(label);
+        part.name = document.getFeatureName(label);
+        parts.append(part);
+    }
+    return parts;
+}
+
+void ShapeExporter::detach(QVector<Part>& parts) {
+    PartCopier copier;
+    copier.parts = &parts;
+    forEachPart(parts.size(), qMax(1, OSD_Parallel::NbLogicalProcessors()), copier);
+}
+
+ShapeExporter::Result ShapeExporter::write(OcafDocument& document, const QString& path, Format format,
+                                           const QString& assemblyName) const {
+    QElapsedTimer timer;
+    timer.start();
+
+    int missing = 0;
+    QVector<Part> parts = collect(document, &missing);
+    Result result = write(parts, path, format, assemblyName);
+    result.missing = missing;
+    if (result.ok) result.milliseconds = timer.nsecsElapsed() / 1.0e6;
+    return result;
+}
+
+ShapeExporter::Result ShapeExporter::write(const QVector<Part>& parts, const QString& path, Format format,
+                                           const QString& assemblyName, const Message_ProgressRange& progress) {
+    Result result;
+    result.ok = false;
+    result.parts = parts.size();
+    result.missing = 0;
+    result.milliseconds = 0.0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    bool written = false;
+
+    if (format == Brep) {
+        BRep_Builder builder;
+        TopoDS_Compound compound;
+        builder.MakeCompound(compound);
+        for (const Part& part : parts) builder.Add(compound, part.shape);
+        written = writeBrep(compound, path, progress);
+    } else {
+        // A standalone XCAF document: nothing here is ever stored, so it
+        // needs no application or drivers
+        Handle(TDocStd_Document) xdoc = new TDocStd_Document("BinXCAF");
+        Handle(XCAFDoc_ShapeTool) shapeTool = XCAFDoc_DocumentTool::ShapeTool(xdoc->Main());
+
+        // Every part is named below; skip the generated names
+        bool autoNaming = XCAFDoc_ShapeTool::AutoNaming();
+        XCAFDoc_ShapeTool::SetAutoNaming(Standard_False);
+
+        TDF_Label assembly = shapeTool->NewShape();
+        QString rootName = assemblyName.isEmpty() ? QFileInfo(path).completeBaseName() : assemblyName;
+        TDataStd_Name::Set(assembly, extendedString(rootName));
+
+        for (const Part& part : parts) {
+            TDF_Label partLabel = shapeTool->AddShape(part.shape, Standard_False, Standard_False);
+            TCollection_ExtendedString name = extendedString(part.name);
+            TDataStd_Name::Set(partLabel, name);
+            TDF_Label component = shapeTool->AddComponent(assembly, partLabel, TopLoc_Location());
+            if (!component.IsNull()) TDataStd_Name::Set(component, name);
+        }
+        // One compound rebuild instead of one per component
+        shapeTool->UpdateAssemblies();
+
+        XCAFDoc_ShapeTool::SetAutoNaming(autoNaming);
+
+        QByteArray file = QFile::encodeName(PartialFile::path(path));
+        if (format == Step) {
+            STEPCAFControl_Writer writer;
+            writer.SetNameMode(Standard_True);
+            writer.SetColorMode(Standard_False);
+            writer.SetLayerMode(Standard_False);
+            writer.SetPropsMode(Standard_False);
+            written = writer.Transfer(xdoc, STEPControl_AsIs, nullptr, progress)
+                      && writer.Write(file.constData()) == IFSelect_RetDone;
+        } else {
+            IGESCAFControl_Writer writer;
+            writer.SetNameMode(Standard_True);
+            writer.SetColorMode(Standard_False);
+            writer.SetLayerMode(Standard_False);
+            written = writer.Transfer(xdoc, progress) && writer.Write(file.constData());
+        }
+        if (written) {
+            written = PartialFile::commit(path);
+        } else {
+            PartialFile::discard(path);
+        }
+    }
+
+    if (!written) {
+        result.error = "Cannot write " + path;
+        return result;
+    }
+
+    result.ok = true;
+    result.milliseconds = timer.nsecsElapsed() / 1.0e6;
+    return result;
+}
+
+ShapeExporter::Result ShapeExporter::writeParts(OcafDocument& document, const QString& directory) const {
+    Result result;
+    result.ok = false;
+    result.parts = 0;
+    result.missing = 0;
+    result.milliseconds = 0.0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!QDir().mkpath(directory)) {
+        result.error = "Cannot create " + directory;
+        return result;
+    }
+
+    QVector<Part> parts = collect(document, &result.missing);
+    result.parts = parts.size();
+
+    QDir dir(directory);
+    QVector<QString> paths;
+    paths.reserve(parts.size());
+    for (const Part& part : parts) paths.append(dir.filePath(fileNameFor(part.id, part.name)));
+    QVector<char> written(parts.size(), 0);
+
+    PartWriter writer;
+    writer.parts = &parts;
+    writer.paths = &paths;
+    writer.written = &written;
+
+    int threads = m_threadCount > 0 ? m_threadCount : qMax(1, OSD_Parallel::NbLogicalProcessors());
+    forEachPart(parts.size(), threads, writer);
+
+    int failed = 0;
+    for (int i = 0; i < parts.size(); ++i) {
+        if (written[i]) continue;
+        if (failed++ == 0) result.error = "Cannot write " + paths[i];
+    }
+    if (failed > 0) {
+        if (failed > 1) result.error += QString(" and %1 other part(s)").arg(failed - 1);
+        return result;
+    }
+
+    result.ok = true;
+    result.milliseconds = timer.nsecsElapsed() / 1.0e6;
+    return result;
+}
+
+QString ShapeExporter::benchmark(int parts) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) return "Cannot create a temporary directory\n";
+
+    OcafDocument doc;
+    doc.newDocument();
+    for (int i = 0; i < parts; ++i) {
+        double x = (i % 100) * 20.0;
+        double y = (i / 100) * 20.0;
+        const double outline[] = { x, y, x + 10, y, x + 10, y + 10, x, y + 10, x, y };
+
+        TDF_Label sketch = doc.createSketch(CustomPlane::XY(), QString("Sketch %1").arg(i));
+        doc.addPolylineToSketch(sketch, outline, 5);
+        doc.createExtrude(sketch, 5.0 + (i % 7), QString("Part %1").arg(i));
+    }
+
+    // Shapes are built up front so only the writing is timed
+    QElapsedTimer timer;
+    timer.start();
+    Regenerator regen;
+    regen.setDocument(&doc);
+    regen.regenerate();
+
+    QString report = QString("Export of %1 parts (regeneration %2 ms)\n")
+                         .arg(parts).arg(timer.nsecsElapsed() / 1.0e6, 0, 'f', 1);
+
+    ShapeExporter exporter;
+    const struct {
+        const char* file;
+        Format format;
+    } formats[] = { { "parts.step", Step }, { "parts.igs", Iges }, { "parts.brep", Brep } };
+
+    for (const auto& entry : formats) {
+        Result result = exporter.write(doc, dir.filePath(entry.file), entry.format);
+        if (!result.ok) return report + result.error + "\n";
+        report += QString("%1: time=%2 ms size=%3 KB\n")
+                      .arg(entry.file)
+                      .arg(result.milliseconds, 0, 'f', 1)
+                      .arg(QFileInfo(dir.filePath(entry.file)).size() / 1024);
+    }
+
+    int cores = qMax(1, OSD_Parallel::NbLogicalProcessors());
+    QVector<int> threadCounts;
+    threadCounts << 1;
+    if (cores > 1) threadCounts << cores;
+
+    double serialMs = 0.0;
+    for (int threads : threadCounts) {
+        exporter.setThreadCount(threads);
+        Result result = exporter.writeParts(doc, dir.filePath(QString("parts-%1").arg(threads)));
+        if (!result.ok) return report + result.error + "\n";
+
+        if (threads == 1) serialMs = result.milliseconds;
+        report += QString("per-part brep: threads=%1 time=%2 ms speedup=%3x\n")
+                      .arg(threads)
+                      .arg(result.milliseconds, 0, 'f', 1)
+                      .arg(result.milliseconds > 0.0 ? serialMs / result.milliseconds : 0.0, 0, 'f', 2);
+    }
+    return report;
+}
@@ -0,0 +1,87 @@
+#ifndef SHAPEEXPORTER_H
+#define SHAPEEXPORTER_H
+
+#include <Message_ProgressRange.hxx>
+#include <TopoDS_Shape.hxx>
+
+#include <QString>
+#include <QVector>
+
+class OcafDocument;
+
+// Writes the regenerated shapes of a document to STEP, IGES or BREP.
+// Dirty features are rebuilt first, then every extrude with a shape
+// becomes one part. STEP and IGES files get an XCAF assembly with one
+// component per part, named after its feature; a BREP file holds one
+// compound. Output goes through PartialFile, so an existing file is only
+// replaced by a complete one.
+//
+// Collecting reads the document and must run on its thread; the parts
+// it returns can be detached and written on another one. The STEP and
+// IGES translators keep their parameters in process-wide statics, so one
+// export transfers its parts serially and exports must not run
+// concurrently. BREP serialization is reentrant: writeParts writes one
+// file per part on the thread pool.
+class ShapeExporter {
+public:
+    enum Format {
+        Step,
+        Iges,
+        Brep
+    };
+
+    struct Part {
+        int id;
+        QString name;
+        TopoDS_Shape shape;
+    };
+
+    struct Result {
+        bool ok;
+        int parts;
+        // Extrudes left out because they have no shape
+        int missing;
+        double milliseconds;
+        QString error;
+    };
+
+    ShapeExporter();
+
+    // 0 uses every core; applies to regeneration and writeParts
+    void setThreadCount(int threads) { m_threadCount = qMax(0, threads); }
+
+    // Format from the suffix of path: .step/.stp, .iges/.igs or .brep
+    static bool formatForPath(const QString& path, Format& format);
+
+    // Rebuilds dirty features and returns every extrude with a shape;
+    // missing counts the extrudes without one
+    QVector<Part> collect(OcafDocument& document, int* missing = nullptr) const;
+
+    // Replaces the shapes by topology copies over the same geometry,
+    // without triangulations, so they can be written on another thread
+    // while the document's shapes are meshed or edited
+    static void detach(QVector<Part>& parts);
+
+    // Writes every part to path; assemblyName names the STEP/IGES root
+    Result write(OcafDocument& document, const QString& path, Format format,
+                 const QString& assemblyName = QString()) const;
+    // The same for collected parts; progress may break the transfer
+    static Result write(const QVector<Part>& parts, const QString& path, Format format,
+                        const QString& assemblyName = QString(),
+                        const Message_ProgressRange& progress = Message_ProgressRange());
+
+    // Writes every part to "<directory>/<id>_<name>.brep" in parallel
+    Result writeParts(OcafDocument& document, const QString& directory) const;
+
+    // Builds a synthetic document of the given number of extrudes and
+    // times writing it in every format; returns a text report
+    static QString benchmark(int parts);
+
+private:
+    struct PartWriter;
+    struct PartCopier;
+
+    int m_threadCount;
+};
+
+#endif
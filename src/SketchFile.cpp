@@ -0,0 +1,568 @@
+#include "SketchFile.h"
+#include "OcafDocument.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const char kMagic[8] = { 'A', 'I', 'C', 'A', 'D', 'S', 'K', 'B' };
+    const quint32 kVersion = 1;
+    const quint32 kByteOrderMark = 0x01020304;
+    const qint64 kAlignment = 16;
+
+    enum SectionType {
+        SketchSection = 1,
+        OffsetSection,
+        PointSection,
+        ExtrudeSection,
+        NameSection,
+        SectionCount = NameSection
+    };
+
+    struct FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 sectionCount;
+        quint32 reserved;
+        quint64 fileSize;
+    };
+
+    struct SectionEntry {
+        quint32 type;
+        quint32 reserved;
+        quint64 offset;
+        quint64 count;
+        quint64 byteSize;
+    };
+
+    qint64 aligned(qint64 offset) {
+        return (offset + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    qint64 elementSize(quint32 type) {
+        switch (type) {
+        case SketchSection: return sizeof(SketchFile::SketchRecord);
+        case OffsetSection: return sizeof(qint32);
+        case PointSection: return 2 * sizeof(double);
+        case ExtrudeSection: return sizeof(SketchFile::ExtrudeRecord);
+        case NameSection: return 1;
+        default: return 0;
+        }
+    }
+
+    void setError(QString* error, const QString& message) {
+        if (error) *error = message;
+    }
+
+    qint32 appendName(QByteArray& names, const QString& name) {
+        if (name.isEmpty()) return -1;
+        qint32 offset = names.size();
+        names += name.toUtf8();
+        names += '\0';
+        return offset;
+    }
+
+    bool readVector(QTextStream& in, QVector3D& v) {
+        double x, y, z;
+        in >> x >> y >> z;
+        v = QVector3D(x, y, z);
+        return in.status() == QTextStream::Ok;
+    }
+
+    bool readPlane(QTextStream& in, CustomPlane& plane) {
+        return readVector(in, plane.origin) && readVector(in, plane.normal) &&
+               readVector(in, plane.uAxis) && readVector(in, plane.vAxis);
+    }
+
+    // "Sketches n", then per sketch "Sketch id <plane> polylines" followed
+    // by "Polyline <plane> n x y ...", then "Features n" with
+    // "Extrude id sketchId height dx dy dz"
+    bool readCad(QTextStream& in, SketchFile::Contents& contents, QString* error) {
+        int sketchCount = 0;
+        in >> sketchCount;
+        for (int s = 0; s < sketchCount; ++s) {
+            QString token;
+            int polylineCount = 0;
+            SketchFile::Sketch sketch;
+            in >> token >> sketch.id;
+            if (token != "Sketch" || !readPlane(in, sketch.plane)) {
+                setError(error, QString("Bad sketch %1").arg(s + 1));
+                return false;
+            }
+            in >> polylineCount;
+
+            QVector<double> xy;
+            for (int k = 0; k < polylineCount; ++k) {
+                CustomPlane plane;
+                int numPoints = 0;
+                in >> token;
+                if (token != "Polyline" || !readPlane(in, plane)) {
+                    setError(error, QString("Bad polyline in sketch %1").arg(sketch.id));
+                    return false;
+                }
+                in >> numPoints;
+                xy.resize(2 * qMax(0, numPoints));
+                for (double& c : xy) in >> c;
+                if (in.status() != QTextStream::Ok) {
+                    setError(error, QString("Bad polyline in sketch %1").arg(sketch.id));
+                    return false;
+                }
+                sketch.polylines.append(xy.constData(), numPoints);
+            }
+            contents.sketches.append(sketch);
+        }
+
+        QString token;
+        int featureCount = 0;
+        in >> token >> featureCount;
+        if (token.isEmpty()) return true;
+        if (token != "Features") {
+            setError(error, "Expected Features after the sketches");
+            return false;
+        }
+
+        for (int f = 0; f < featureCount; ++f) {
+            SketchFile::Extrude extrude;
+            QVector3D direction;
+            in >> token >> extrude.id >> extrude.sketchId >> extrude.height;
+            // The direction is the sketch normal and not stored separately
+            if (token != "Extrude" || !readVector(in, direction)) {
+                setError(error, QString("Bad feature %1").arg(f + 1));
+                return false;
+            }
+            contents.extrudes.append(extrude);
+        }
+        return true;
+    }
+
+    // "LINE x1 y1 x2 y2" and "ARC cx cy radius start sweep", one per line
+    bool readDrawing(QTextStream& in, QString token, const QString& name,
+                     SketchFile::Contents& contents, QString* error) {
+        SketchFile::Sketch sketch;
+        sketch.id = 1;
+        sketch.name = name;
+        sketch.plane = CustomPlane::XY();
+
+        // Connected LINEs become one polyline, as in EntityImporter
+        bool chain = false;
+        int entity = 0;
+        while (!token.isEmpty()) {
+            ++entity;
+            if (token == "LINE") {
+                double xy[4];
+                in >> xy[0] >> xy[1] >> xy[2] >> xy[3];
+                if (in.status() == QTextStream::Ok) sketch.polylines.appendSegment(xy, chain);
+                chain = true;
+            } else if (token == "ARC") {
+                double cx, cy, radius, start, sweep;
+                in >> cx >> cy >> radius >> start >> sweep;
+                if (in.status() == QTextStream::Ok) sketch.polylines.appendArc(cx, cy, radius, start, sweep);
+                chain = false;
+            } else {
+                setError(error, QString("Unknown entity %1 at entity %2").arg(token).arg(entity));
+                return false;
+            }
+            if (in.status() != QTextStream::Ok) {
+                setError(error, QString("Bad %1 at entity %2").arg(token).arg(entity));
+                return false;
+            }
+            token.clear();
+            in >> token;
+        }
+
+        contents.sketches.append(sketch);
+        return true;
+    }
+}
+
+SketchFile::SketchFile()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_sketches(nullptr)
+    , m_sketchCount(0)
+    , m_offsets(nullptr)
+    , m_polylineCount(0)
+    , m_points(nullptr)
+    , m_pointCount(0)
+    , m_extrudes(nullptr)
+    , m_extrudeCount(0)
+    , m_names(nullptr)
+    , m_namesSize(0)
+{
+}
+
+SketchFile::~SketchFile() {
+    close();
+}
+
+bool SketchFile::fail(const QString& message) {
+    close();
+    m_error = message;
+    return false;
+}
+
+void SketchFile::close() {
+    if (m_data) m_file.unmap(m_data);
+    if (m_file.isOpen()) m_file.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_sketches = nullptr;
+    m_sketchCount = 0;
+    m_offsets = nullptr;
+    m_polylineCount = 0;
+    m_points = nullptr;
+    m_pointCount = 0;
+    m_extrudes = nullptr;
+    m_extrudeCount = 0;
+    m_names = nullptr;
+    m_namesSize = 0;
+}
+
+bool SketchFile::open(const QString& path) {
+    close();
+    m_error.clear();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) return fail("Cannot open " + path);
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(FileHeader))) return fail("Not a sketch file");
+    m_data = m_file.map(0, m_size);
+    if (!m_data) return fail("Cannot map " + path);
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_data);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) return fail("Not a sketch file");
+    if (header->byteOrder != kByteOrderMark) return fail("Sketch file has the wrong byte order");
+    if (header->version != kVersion) return fail(QString("Unsupported sketch file version %1").arg(header->version));
+    if (qint64(header->fileSize) != m_size) return fail("Sketch file is truncated");
+
+    qint64 tableEnd = sizeof(FileHeader) + qint64(header->sectionCount) * sizeof(SectionEntry);
+    if (header->sectionCount > 64 || tableEnd > m_size) return fail("Bad section table");
+
+    // Only bounds are checked; the arrays are used as they are
+    const SectionEntry* sections = reinterpret_cast<const SectionEntry*>(m_data + sizeof(FileHeader));
+    for (quint32 i = 0; i < header->sectionCount; ++i) {
+        const SectionEntry& section = sections[i];
+        qint64 size = elementSize(section.type);
+        if (size == 0) continue;  // from a newer writer
+        // Written so that no sum or product can wrap: the count is capped
+        // before it is multiplied and the size is compared with what is
+        // left after the offset
+        if (section.count > 0x7fffffff || section.byteSize != section.count * quint64(size) ||
+            section.offset % kAlignment != 0 || section.offset < quint64(tableEnd) ||
+            section.offset > quint64(m_size) || section.byteSize > quint64(m_size) - section.offset) {
+            return fail(QString("Bad section %1").arg(section.type));
+        }
+
+        const uchar* data = m_data + section.offset;
+        int count = int(section.count);
+        switch (section.type) {
+        case SketchSection:
+            m_sketches = reinterpret_cast<const SketchRecord*>(data);
+            m_sketchCount = count;
+            break;
+        case OffsetSection:
+            m_offsets = reinterpret_cast<const qint32*>(data);
+            m_polylineCount = qMax(0, count - 1);
+            break;
+        case PointSection:
+            m_points = reinterpret_cast<const double*>(data);
+            m_pointCount = count;
+            break;
+        case ExtrudeSection:
+            m_extrudes = reinterpret_cast<const ExtrudeRecord*>(data);
+            m_extrudeCount = count;
+            break;
+        case NameSection:
+            m_names = reinterpret_cast<const char*>(data);
+            m_namesSize = count;
+            break;
+        }
+    }
+
+    // Enough to keep every polyline view inside the point array
+    if (m_polylineCount > 0) {
+        if (m_offsets[0] != 0 || m_offsets[m_polylineCount] != m_pointCount) {
+            return fail("Bad polyline offsets");
+        }
+        for (int k = 0; k < m_polylineCount; ++k) {
+            if (m_offsets[k + 1] < m_offsets[k]) return fail("Bad polyline offsets");
+        }
+    }
+    for (int s = 0; s < m_sketchCount; ++s) {
+        const SketchRecord& record = m_sketches[s];
+        if (record.firstPolyline < 0 || record.polylineCount < 0 ||
+            qint64(record.firstPolyline) + record.polylineCount > m_polylineCount) {
+            return fail(QString("Bad sketch %1").arg(record.id));
+        }
+    }
+    if (m_namesSize > 0 && m_names[m_namesSize - 1] != '\0') return fail("Bad names");
+
+    return true;
+}
+
+CustomPlane SketchFile::sketchPlane(int index) const {
+    const double* p = m_sketches[index].plane;
+    CustomPlane plane;
+    plane.origin = QVector3D(p[0], p[1], p[2]);
+    plane.normal = QVector3D(p[3], p[4], p[5]);
+    plane.uAxis = QVector3D(p[6], p[7], p[8]);
+    plane.vAxis = QVector3D(p[9], p[10], p[11]);
+    return plane;
+}
+
+SketchPolylineView SketchFile::polyline(int index) const {
+    SketchPolylineView view;
+    view.xy = m_points + 2 * m_offsets[index];
+    view.pointCount = m_offsets[index + 1] - m_offsets[index];
+    return view;
+}
+
+QString SketchFile::name(qint32 offset) const {
+    if (offset < 0 || offset >= m_namesSize) return QString();
+    return QString::fromUtf8(m_names + offset);
+}
+
+int SketchFile::addToDocument(OcafDocument& document) const {
+    if (!isOpen()) return 0;
+
+    document.beginBatch();
+
+    QHash<int, TDF_Label> sketchLabels;
+    for (int s = 0; s < m_sketchCount; ++s) {
+        const SketchRecord& record = m_sketches[s];
+        QString sketchName = name(record.name);
+        TDF_Label label = document.createSketch(sketchPlane(s), sketchName.isEmpty() ? "Sketch" : sketchName);
+        if (sketchName.isEmpty()) {
+            document.setFeatureName(label, QString("Sketch %1").arg(document.getFeatureId(label)));
+        }
+        sketchLabels.insert(record.id, label);
+
+        if (record.polylineCount == 0) continue;
+
+        // The sketch's polylines are contiguous in the file; one copy and
+        // one attribute update for all of them
+        const qint32* offsets = m_offsets + record.firstPolyline;
+        int firstPoint = offsets[0];
+        SketchPolylineSet polylines;
+        polylines.coords.resize(2 * (offsets[record.polylineCount] - firstPoint));
+        std::copy(m_points + 2 * firstPoint, m_points + 2 * offsets[record.polylineCount],
+                  polylines.coords.data());
+        polylines.offsets.reserve(record.polylineCount + 1);
+        for (int k = 0; k <= record.polylineCount; ++k) {
+            polylines.offsets.append(offsets[k] - firstPoint);
+        }
+        document.addPolylinesToSketch(label, polylines);
+    }
+
+    int added = m_sketchCount;
+    for (int e = 0; e < m_extrudeCount; ++e) {
+        const ExtrudeRecord& record = m_extrudes[e];
+        TDF_Label sketch = sketchLabels.value(record.sketchId);
+        if (sketch.IsNull()) continue;
+
+        QString extrudeName = name(record.name);
+        TDF_Label label = document.createExtrude(sketch, record.height, extrudeName.isEmpty() ? "Extrude" : extrudeName);
+        if (extrudeName.isEmpty()) {
+            document.setFeatureName(label, QString("Extrude %1").arg(document.getFeatureId(label)));
+        }
+        ++added;
+    }
+
+    document.endBatch();
+    return added;
+}
+
+bool SketchFile::write(const QString& path, const Contents& contents, QString* error) {
+    QByteArray names;
+    QVector<SketchRecord> sketches;
+    QVector<qint32> offsets;
+    QVector<ExtrudeRecord> extrudes;
+
+    qint64 totalPoints = 0;
+    for (const Sketch& sketch : contents.sketches) totalPoints += sketch.polylines.pointCount();
+    if (totalPoints > 0x7fffffff) {
+        setError(error, "Too many points for one sketch file");
+        return false;
+    }
+
+    sketches.reserve(contents.sketches.size());
+    offsets.append(0);
+    for (const Sketch& sketch : contents.sketches) {
+        SketchRecord record;
+        const QVector3D* axes[4] = { &sketch.plane.origin, &sketch.plane.normal,
+                                     &sketch.plane.uAxis, &sketch.plane.vAxis };
+        for (int a = 0; a < 4; ++a) {
+            record.plane[3 * a] = axes[a]->x();
+            record.plane[3 * a + 1] = axes[a]->y();
+            record.plane[3 * a + 2] = axes[a]->z();
+        }
+        record.id = sketch.id;
+        record.firstPolyline = offsets.size() - 1;
+        record.polylineCount = sketch.polylines.polylineCount();
+        record.name = appendName(names, sketch.name);
+        sketches.append(record);
+
+        qint32 base = offsets.last();
+        for (int k = 0; k < sketch.polylines.polylineCount(); ++k) {
+            offsets.append(base + sketch.polylines.offsets[k + 1]);
+        }
+    }
+
+    extrudes.reserve(contents.extrudes.size());
+    for (const Extrude& extrude : contents.extrudes) {
+        ExtrudeRecord record;
+        record.height = extrude.height;
+        record.id = extrude.id;
+        record.sketchId = extrude.sketchId;
+        record.name = appendName(names, extrude.name);
+        record.reserved = 0;
+        extrudes.append(record);
+    }
+
+    SectionEntry sections[SectionCount];
+    const qint64 counts[SectionCount] = { sketches.size(), offsets.size(), totalPoints,
+                                          extrudes.size(), names.size() };
+    qint64 offset = sizeof(FileHeader) + sizeof(sections);
+    for (int i = 0; i < SectionCount; ++i) {
+        SectionEntry& section = sections[i];
+        section.type = i + 1;
+        section.reserved = 0;
+        section.offset = aligned(offset);
+        section.count = counts[i];
+        section.byteSize = counts[i] * elementSize(section.type);
+        offset = section.offset + section.byteSize;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.sectionCount = SectionCount;
+    header.reserved = 0;
+    header.fileSize = offset;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, "Cannot write " + path);
+        return false;
+    }
+
+    qint64 position = 0;
+    auto put = [&file, &position](const void* data, qint64 size) {
+        file.write(static_cast<const char*>(data), size);
+        position += size;
+    };
+    auto pad = [&put, &position](qint64 to) {
+        static const char zeros[kAlignment] = {};
+        put(zeros, to - position);
+    };
+
+    put(&header, sizeof(header));
+    put(sections, sizeof(sections));
+    pad(sections[0].offset);
+    put(sketches.constData(), sections[0].byteSize);
+    pad(sections[1].offset);
+    put(offsets.constData(), sections[1].byteSize);
+    pad(sections[2].offset);
+    for (const Sketch& sketch : contents.sketches) {
+        put(sketch.polylines.coords.constData(), sketch.polylines.coords.size() * sizeof(double));
+    }
+    pad(sections[3].offset);
+    put(extrudes.constData(), sections[3].byteSize);
+    pad(sections[4].offset);
+    put(names.constData(), sections[4].byteSize);
+
+    if (!file.commit()) {
+        setError(error, "Cannot write " + path);
+        return false;
+    }
+    return true;
+}
+
+bool SketchFile::readLegacyText(const QString& path, Contents& contents, QString* error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setError(error, "Cannot open " + path);
+        return false;
+    }
+
+    QTextStream in(&file);
+    QString token;
+    in >> token;
+    if (token == "Sketches") return readCad(in, contents, error);
+    if (token == "LINE" || token == "ARC") {
+        return readDrawing(in, token, QFileInfo(path).completeBaseName(), contents, error);
+    }
+    setError(error, path + " is neither a .cad document nor a LINE/ARC drawing");
+    return false;
+}
+
+QString SketchFile::benchmark(int entities) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) return "Cannot create a temporary directory\n";
+    QString textPath = dir.filePath("bench.txt");
+    QString binaryPath = dir.filePath("bench.aisk");
+
+    // Written the way LineEntity::save and ArcEntity::save wrote drawings;
+    // every fourth entity is an arc
+    {
+        QFile file(textPath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return "Cannot write " + textPath + "\n";
+        QTextStream out(&file);
+        for (int i = 0; i < entities; ++i) {
+            double x = (i % 1000) * 10.0;
+            double y = (i / 1000) * 10.0;
+            if (i % 4 == 3) {
+                out << "ARC " << x << " " << y << " " << 4.5 << " " << 0.25 << " " << 2.5 << "\n";
+            } else {
+                out << "LINE " << x << " " << y << " " << x + 7.5 << " " << y + 2.5 << "\n";
+            }
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Contents contents;
+    QString error;
+    if (!readLegacyText(textPath, contents, &error)) return error + "\n";
+    double textMs = timer.nsecsElapsed() / 1.0e6;
+
+    timer.restart();
+    if (!write(binaryPath, contents, &error)) return error + "\n";
+    double writeMs = timer.nsecsElapsed() / 1.0e6;
+
+    timer.restart();
+    SketchFile file;
+    if (!file.open(binaryPath)) return file.errorString() + "\n";
+    double openMs = timer.nsecsElapsed() / 1.0e6;
+
+    // Touch every coordinate, as building a presentation would
+    timer.restart();
+    double sum = 0.0;
+    for (int k = 0; k < file.polylineCount(); ++k) {
+        SketchPolylineView view = file.polyline(k);
+        for (int i = 0; i < view.pointCount; ++i) sum += view.x(i) + view.y(i);
+    }
+    double walkMs = timer.nsecsElapsed() / 1.0e6;
+
+    const double mb = 1024.0 * 1024.0;
+    double binaryMs = openMs + walkMs;
+    return QString("Sketch file: %1 LINE/ARC entities, %2 points\n"
+                   "text:   %3 MB, read %4 ms\n"
+                   "binary: %5 MB, write %6 ms, open %7 ms, read all points %8 ms\n"
+                   "speedup: %9x (checksum %10)\n")
+        .arg(entities).arg(file.pointCount())
+        .arg(QFileInfo(textPath).size() / mb, 0, 'f', 1).arg(textMs, 0, 'f', 1)
+        .arg(QFileInfo(binaryPath).size() / mb, 0, 'f', 1).arg(writeMs, 0, 'f', 1)
+        .arg(openMs, 0, 'f', 2).arg(walkMs, 0, 'f', 1)
+        .arg(binaryMs > 0.0 ? textMs / binaryMs : 0.0, 0, 'f', 0)
+        .arg(sum, 0, 'g', 6);
+}
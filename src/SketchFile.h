@@ -0,0 +1,122 @@
+#ifndef SKETCHFILE_H
+#define SKETCHFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "CustomPlane.h"
+#include "SketchPolyline.h"
+
+class OcafDocument;
+
+// Binary container for sketches and the extrudes built on them (.aisk).
+// The file is memory-mapped and its arrays are used in place, so opening
+// costs a header check no matter how many entities it holds. Layout, in
+// the byte order of the machine that wrote it:
+//
+//   Header     magic "AICADSKB", version, byte-order mark, section count,
+//              file size
+//   Sections   type, offset, element count and byte size of each section
+//   Sketches   SketchRecord per sketch
+//   Offsets    int32 per polyline plus one: first point of each polyline
+//   Points     interleaved x/y doubles in sketch plane coordinates
+//   Extrudes   ExtrudeRecord per extrude
+//   Names      NUL-terminated UTF-8 strings, referenced by byte offset
+//
+// Every section starts on a 16-byte boundary.
+class SketchFile {
+public:
+    struct SketchRecord {
+        double plane[12];      // origin, normal, u axis, v axis
+        qint32 id;
+        qint32 firstPolyline;
+        qint32 polylineCount;
+        qint32 name;           // offset into the names, -1 for none
+    };
+
+    struct ExtrudeRecord {
+        double height;
+        qint32 id;
+        qint32 sketchId;
+        qint32 name;
+        qint32 reserved;
+    };
+
+    // Content to write, and what the legacy text readers produce
+    struct Sketch {
+        int id;
+        QString name;
+        CustomPlane plane;
+        SketchPolylineSet polylines;
+    };
+
+    struct Extrude {
+        int id;
+        int sketchId;
+        double height;
+        QString name;
+    };
+
+    struct Contents {
+        QVector<Sketch> sketches;
+        QVector<Extrude> extrudes;
+    };
+
+    SketchFile();
+    ~SketchFile();
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    QString errorString() const { return m_error; }
+
+    int sketchCount() const { return m_sketchCount; }
+    const SketchRecord& sketch(int index) const { return m_sketches[index]; }
+    CustomPlane sketchPlane(int index) const;
+    int polylineCount() const { return m_polylineCount; }
+    int pointCount() const { return m_pointCount; }
+    // Points straight from the mapping; valid until close()
+    SketchPolylineView polyline(int index) const;
+    int extrudeCount() const { return m_extrudeCount; }
+    const ExtrudeRecord& extrude(int index) const { return m_extrudes[index]; }
+    QString name(qint32 offset) const;
+
+    // Adds every sketch and extrude as new features in one undo step;
+    // feature IDs are assigned by the document. Returns the feature count.
+    int addToDocument(OcafDocument& document) const;
+
+    static bool write(const QString& path, const Contents& contents, QString* error = nullptr);
+
+    // Legacy text formats, token by token through QTextStream: .cad
+    // documents ("Sketches"/"Features" sections) and LINE/ARC drawings
+    // like Drawing1.txt, which become one sketch on the XY plane with
+    // connected LINEs joined and arcs flattened to polylines, the same
+    // polylines EntityImporter builds
+    static bool readLegacyText(const QString& path, Contents& contents, QString* error = nullptr);
+
+    // Writes the given number of LINE/ARC entities as text, converts them
+    // to a container and times reading both
+    static QString benchmark(int entities);
+
+private:
+    bool fail(const QString& message);
+
+    QFile m_file;
+    uchar* m_data;
+    qint64 m_size;
+    QString m_error;
+
+    const SketchRecord* m_sketches;
+    int m_sketchCount;
+    const qint32* m_offsets;
+    int m_polylineCount;
+    const double* m_points;
+    int m_pointCount;
+    const ExtrudeRecord* m_extrudes;
+    int m_extrudeCount;
+    const char* m_names;
+    qint64 m_namesSize;
+};
+
+#endif
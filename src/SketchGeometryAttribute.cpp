@@ -0,0 +1,73 @@
+#include "SketchGeometryAttribute.h"
+
+#include <TDF_RelocationTable.hxx>
+
+IMPLEMENT_STANDARD_RTTIEXT(SketchGeometryAttribute, TDF_Attribute)
+
+const Standard_GUID& SketchGeometryAttribute::GetID() {
+    static const Standard_GUID id("12345678-1234-1234-1234-00000000000a");
+    return id;
+}
+
+Handle(SketchGeometryAttribute) SketchGeometryAttribute::Set(const TDF_Label& label) {
+    Handle(SketchGeometryAttribute) attr;
+    if (!label.FindAttribute(GetID(), attr)) {
+        attr = new SketchGeometryAttribute();
+        label.AddAttribute(attr);
+    }
+    return attr;
+}
+
+SketchGeometryAttribute::SketchGeometryAttribute() {
+}
+
+void SketchGeometryAttribute::appendPolyline(const double* xy, int numPoints) {
+    if (numPoints <= 0) return;
+
+    Backup();
+    m_polylines.append(xy, numPoints);
+}
+
+void SketchGeometryAttribute::appendPolylines(const SketchPolylineSet& polylines) {
+    if (polylines.polylineCount() == 0) return;
+
+    Backup();
+    m_polylines.append(polylines);
+}
+
+void SketchGeometryAttribute::clear() {
+    Backup();
+    m_polylines = SketchPolylineSet();
+}
+
+void SketchGeometryAttribute::setPacked(const QVector<double>& coords, const QVector<int>& offsets) {
+    Backup();
+    m_polylines.coords = coords;
+    m_polylines.offsets = offsets;
+}
+
+const Standard_GUID& SketchGeometryAttribute::ID() const {
+    return GetID();
+}
+
+void SketchGeometryAttribute::Restore(const Handle(TDF_Attribute)& with) {
+    Handle(SketchGeometryAttribute) other = Handle(SketchGeometryAttribute)::DownCast(with);
+    m_polylines = other->m_polylines;
+}
+
+Handle(TDF_Attribute) SketchGeometryAttribute::NewEmpty() const {
+    return new SketchGeometryAttribute();
+}
+
+void SketchGeometryAttribute::Paste(const Handle(TDF_Attribute)& into,
+                                    const Handle(TDF_RelocationTable)& relocationTable) const {
+    (void)relocationTable;
+    Handle(SketchGeometryAttribute) target = Handle(SketchGeometryAttribute)::DownCast(into);
+    target->m_polylines = m_polylines;
+}
+
+Standard_OStream& SketchGeometryAttribute::Dump(Standard_OStream& stream) const {
+    stream << "SketchGeometryAttribute: " << polylineCount() << " polylines, "
+           << pointCount() << " points\n";
+    return stream;
+}
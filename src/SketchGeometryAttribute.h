@@ -0,0 +1,56 @@
+#ifndef SKETCHGEOMETRYATTRIBUTE_H
+#define SKETCHGEOMETRYATTRIBUTE_H
+
+#include <TDF_Attribute.hxx>
+#include <TDF_Label.hxx>
+#include <Standard_GUID.hxx>
+
+#include "SketchPolyline.h"
+
+// All polylines of one sketch packed into a single coordinate buffer
+// plus an offset table, instead of one child label per polyline.
+class SketchGeometryAttribute : public TDF_Attribute {
+public:
+    static const Standard_GUID& GetID();
+    // Finds the attribute on label or creates an empty one
+    static Handle(SketchGeometryAttribute) Set(const TDF_Label& label);
+
+    SketchGeometryAttribute();
+
+    int polylineCount() const { return m_polylines.polylineCount(); }
+    int pointCount() const { return m_polylines.pointCount(); }
+    SketchPolylineView polyline(int index) const { return m_polylines.polyline(index); }
+    const SketchPolylineSet& polylines() const { return m_polylines; }
+
+    // Whole buffer: point i of the sketch is at coordinates()[2 * i]
+    const double* coordinates() const { return m_polylines.coords.constData(); }
+    // polylineCount() + 1 entries; polyline k spans points
+    // [offsets()[k], offsets()[k + 1])
+    const int* offsets() const { return m_polylines.offsets.constData(); }
+
+    void appendPolyline(const double* xy, int numPoints);
+    void appendPolylines(const SketchPolylineSet& polylines);
+    void clear();
+
+    // Raw access for persistence drivers; replaces the whole content
+    void setPacked(const QVector<double>& coords, const QVector<int>& offsets);
+    const QVector<double>& packedCoordinates() const { return m_polylines.coords; }
+    const QVector<int>& packedOffsets() const { return m_polylines.offsets; }
+
+    const Standard_GUID& ID() const Standard_OVERRIDE;
+    void Restore(const Handle(TDF_Attribute)& with) Standard_OVERRIDE;
+    Handle(TDF_Attribute) NewEmpty() const Standard_OVERRIDE;
+    void Paste(const Handle(TDF_Attribute)& into,
+               const Handle(TDF_RelocationTable)& relocationTable) const Standard_OVERRIDE;
+    Standard_OStream& Dump(Standard_OStream& stream) const Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(SketchGeometryAttribute, TDF_Attribute)
+
+private:
+    // Implicitly shared, so undo backups copy nothing until the next edit
+    SketchPolylineSet m_polylines;
+};
+
+DEFINE_STANDARD_HANDLE(SketchGeometryAttribute, TDF_Attribute)
+
+#endif
@@ -0,0 +1,58 @@
+#include "SketchPolyline.h"
+
+#include <QVarLengthArray>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+void SketchPolylineSet::append(const double* xy, int numPoints) {
+    if (numPoints <= 0) return;
+
+    if (offsets.isEmpty()) offsets.append(0);
+    int start = coords.size();
+    coords.resize(start + 2 * numPoints);
+    std::copy(xy, xy + 2 * numPoints, coords.data() + start);
+    offsets.append(offsets.last() + numPoints);
+}
+
+void SketchPolylineSet::appendSegment(const double* xy, bool chain) {
+    int last = pointCount() - 1;
+    if (chain && last >= 0 && coords.at(2 * last) == xy[0] && coords.at(2 * last + 1) == xy[1]) {
+        coords.append(xy[2]);
+        coords.append(xy[3]);
+        ++offsets.last();
+    } else {
+        append(xy, 2);
+    }
+}
+
+void SketchPolylineSet::append(const SketchPolylineSet& other) {
+    if (other.polylineCount() == 0) return;
+    if (polylineCount() == 0) {
+        // Shares the buffers instead of copying them
+        *this = other;
+        return;
+    }
+
+    int firstPoint = pointCount();
+    coords += other.coords;
+    offsets.reserve(offsets.size() + other.polylineCount());
+    for (int k = 1; k < other.offsets.size(); ++k) {
+        offsets.append(firstPoint + other.offsets[k]);
+    }
+}
+
+void SketchPolylineSet::appendArc(double cx, double cy, double radius, double start, double sweep) {
+    // One segment per 5.6 degrees of sweep
+    const double step = M_PI / 32.0;
+    int segments = qBound(2, int(std::ceil(std::abs(sweep) / step)), 1024);
+
+    QVarLengthArray<double, 130> xy(2 * (segments + 1));
+    for (int i = 0; i <= segments; ++i) {
+        double angle = start + sweep * i / segments;
+        xy[2 * i] = cx + radius * std::cos(angle);
+        xy[2 * i + 1] = cy + radius * std::sin(angle);
+    }
+    append(xy.constData(), segments + 1);
+}
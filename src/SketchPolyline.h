@@ -0,0 +1,44 @@
+#ifndef SKETCHPOLYLINE_H
+#define SKETCHPOLYLINE_H
+
+#include <QVector>
+
+// Read-only view of one polyline inside a SketchPolylineSet. Points are
+// stored as interleaved x/y doubles; the view stays valid until the set
+// is modified.
+struct SketchPolylineView {
+    const double* xy;
+    int pointCount;
+
+    double x(int i) const { return xy[2 * i]; }
+    double y(int i) const { return xy[2 * i + 1]; }
+};
+
+// A sketch's polylines in the packed layout SketchGeometryAttribute
+// stores. Copies share their buffers, so taking one allocates nothing and
+// it may be read from worker threads while the document keeps changing.
+struct SketchPolylineSet {
+    QVector<double> coords;
+    // Empty or polylineCount() + 1 entries starting at 0
+    QVector<int> offsets;
+
+    int polylineCount() const { return offsets.isEmpty() ? 0 : offsets.size() - 1; }
+    int pointCount() const { return coords.size() / 2; }
+    SketchPolylineView polyline(int index) const {
+        SketchPolylineView view;
+        view.xy = coords.constData() + 2 * offsets[index];
+        view.pointCount = offsets[index + 1] - offsets[index];
+        return view;
+    }
+
+    void append(const double* xy, int numPoints);
+    // Appends the segment xy[0..3]; with chain set, a segment starting
+    // where the last polyline ends extends that polyline instead
+    void appendSegment(const double* xy, bool chain);
+    // Appends every polyline of other
+    void append(const SketchPolylineSet& other);
+    // Flattens a circular arc into a polyline; sweep is signed, in radians
+    void appendArc(double cx, double cy, double radius, double start, double sweep);
+};
+
+#endif
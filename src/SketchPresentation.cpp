@@ -0,0 +1,208 @@
+#include "SketchPresentation.h"
+
+#include <AIS_InteractiveContext.hxx>
+#include <Graphic3d_ArrayOfSegments.hxx>
+#include <Graphic3d_AspectLine3d.hxx>
+#include <Graphic3d_Group.hxx>
+#include <Prs3d_LineAspect.hxx>
+#include <Prs3d_Presentation.hxx>
+#include <PrsMgr_PresentationManager.hxx>
+#include <Select3D_SensitiveCurve.hxx>
+#include <Select3D_SensitiveSegment.hxx>
+#include <SelectMgr_Selection.hxx>
+#include <TColgp_Array1OfPnt.hxx>
+
+#include <QtGlobal>
+
+IMPLEMENT_STANDARD_RTTIEXT(SketchSegmentOwner, SelectMgr_EntityOwner)
+IMPLEMENT_STANDARD_RTTIEXT(SketchPresentation, AIS_InteractiveObject)
+
+SketchSegmentOwner::SketchSegmentOwner(const Handle(SelectMgr_SelectableObject)& sketch,
+                                       int polyline, int segment)
+    : SelectMgr_EntityOwner(sketch, 5)
+    , m_polyline(polyline)
+    , m_segment(segment)
+{
+}
+
+SketchPresentation::SketchPresentation(const SketchPolylineSet& polylines, const CustomPlane& plane)
+    : m_offsets(polylines.offsets)
+{
+    // Segment owners highlight only their segment, see HilightOwnerWithColor
+    SetAutoHilight(Standard_False);
+    myDrawer->SetLineAspect(new Prs3d_LineAspect(Quantity_NOC_WHITE, Aspect_TOL_SOLID, 1.0));
+
+    for (int k = 0; k < 3; ++k) {
+        m_min[k] = 0.0;
+        m_max[k] = 0.0;
+    }
+
+    const int numPoints = polylines.pointCount();
+    const double* xy = polylines.coords.constData();
+    m_points.reserve(numPoints);
+    for (int i = 0; i < numPoints; ++i) {
+        gp_Pnt p = plane.toWorld(xy[2 * i], xy[2 * i + 1]);
+        m_points.append(p);
+
+        const double c[3] = { p.X(), p.Y(), p.Z() };
+        for (int k = 0; k < 3; ++k) {
+            if (i == 0 || c[k] < m_min[k]) m_min[k] = c[k];
+            if (i == 0 || c[k] > m_max[k]) m_max[k] = c[k];
+        }
+    }
+}
+
+int SketchPresentation::segmentCount() const {
+    int count = 0;
+    for (int k = 0; k < polylineCount(); ++k) {
+        count += qMax(0, m_offsets[k + 1] - m_offsets[k] - 1);
+    }
+    return count;
+}
+
+void SketchPresentation::SetColor(const Quantity_Color& color) {
+    AIS_InteractiveObject::SetColor(color);
+    myDrawer->LineAspect()->SetColor(color);
+    SynchronizeAspects();
+}
+
+void SketchPresentation::SetWidth(const Standard_Real width) {
+    AIS_InteractiveObject::SetWidth(width);
+    myDrawer->LineAspect()->SetWidth(width);
+    SynchronizeAspects();
+}
+
+Handle(Graphic3d_ArrayOfPolylines) SketchPresentation::makeArray() const {
+    int numPoints = 0;
+    int numBounds = 0;
+    for (int k = 0; k < polylineCount(); ++k) {
+        int n = m_offsets[k + 1] - m_offsets[k];
+        if (n < 2) continue;
+        numPoints += n;
+        ++numBounds;
+    }
+    if (numBounds == 0) return Handle(Graphic3d_ArrayOfPolylines)();
+
+    Handle(Graphic3d_ArrayOfPolylines) array = new Graphic3d_ArrayOfPolylines(numPoints, numBounds);
+    for (int k = 0; k < polylineCount(); ++k) {
+        int n = m_offsets[k + 1] - m_offsets[k];
+        if (n < 2) continue;
+        array->AddBound(n);
+        for (int i = m_offsets[k]; i < m_offsets[k + 1]; ++i) {
+            array->AddVertex(m_points[i]);
+        }
+    }
+    return array;
+}
+
+void SketchPresentation::Compute(const Handle(PrsMgr_PresentationManager)& manager,
+                                 const Handle(Prs3d_Presentation)& presentation,
+                                 const Standard_Integer mode) {
+    (void)manager;
+    if (mode != 0) return;
+
+    Handle(Graphic3d_ArrayOfPolylines) array = makeArray();
+    if (array.IsNull()) return;
+
+    Handle(Graphic3d_Group) group = presentation->NewGroup();
+    group->SetGroupPrimitivesAspect(myDrawer->LineAspect()->Aspect());
+    // The bounds were collected while converting the points, so the group
+    // does not need another pass over the vertex buffer
+    group->AddPrimitiveArray(array, Standard_False);
+    group->SetMinMaxValues(m_min[0], m_min[1], m_min[2], m_max[0], m_max[1], m_max[2]);
+}
+
+void SketchPresentation::ComputeSelection(const Handle(SelectMgr_Selection)& selection,
+                                          const Standard_Integer mode) {
+    if (mode == SelectWhole) {
+        Handle(SelectMgr_EntityOwner) owner = new SelectMgr_EntityOwner(this, 5);
+        for (int k = 0; k < polylineCount(); ++k) {
+            int first = m_offsets[k];
+            int n = m_offsets[k + 1] - first;
+            if (n < 2) continue;
+
+            TColgp_Array1OfPnt points(1, n);
+            for (int i = 0; i < n; ++i) {
+                points.SetValue(i + 1, m_points[first + i]);
+            }
+            selection->Add(new Select3D_SensitiveCurve(owner, points));
+        }
+    } else if (mode == SelectSegments) {
+        for (int k = 0; k < polylineCount(); ++k) {
+            for (int i = m_offsets[k]; i + 1 < m_offsets[k + 1]; ++i) {
+                Handle(SketchSegmentOwner) owner = new SketchSegmentOwner(this, k, i - m_offsets[k]);
+                selection->Add(new Select3D_SensitiveSegment(owner, m_points[i], m_points[i + 1]));
+            }
+        }
+    }
+}
+
+void SketchPresentation::addHighlight(const Handle(Prs3d_Presentation)& presentation,
+                                      const Handle(Prs3d_Drawer)& style,
+                                      const SelectMgr_SequenceOfOwner& owners) const {
+    bool whole = false;
+    int numSegments = 0;
+    for (SelectMgr_SequenceOfOwner::Iterator it(owners); it.More(); it.Next()) {
+        if (Handle(SketchSegmentOwner)::DownCast(it.Value()).IsNull()) {
+            whole = true;
+        } else {
+            ++numSegments;
+        }
+    }
+
+    Handle(Graphic3d_AspectLine3d) aspect = new Graphic3d_AspectLine3d(
+        style->Color(), Aspect_TOL_SOLID,
+        myDrawer->LineAspect()->Aspect()->LineWidth() + 1.0);
+    Handle(Graphic3d_Group) group = presentation->NewGroup();
+    group->SetGroupPrimitivesAspect(aspect);
+
+    if (whole) {
+        Handle(Graphic3d_ArrayOfPolylines) array = makeArray();
+        if (!array.IsNull()) group->AddPrimitiveArray(array);
+        return;
+    }
+
+    Handle(Graphic3d_ArrayOfSegments) segments = new Graphic3d_ArrayOfSegments(2 * numSegments);
+    for (SelectMgr_SequenceOfOwner::Iterator it(owners); it.More(); it.Next()) {
+        Handle(SketchSegmentOwner) owner = Handle(SketchSegmentOwner)::DownCast(it.Value());
+        int first = m_offsets[owner->polylineIndex()] + owner->segmentIndex();
+        segments->AddVertex(m_points[first]);
+        segments->AddVertex(m_points[first + 1]);
+    }
+    group->AddPrimitiveArray(segments);
+}
+
+void SketchPresentation::HilightOwnerWithColor(const Handle(PrsMgr_PresentationManager)& manager,
+                                               const Handle(Prs3d_Drawer)& style,
+                                               const Handle(SelectMgr_EntityOwner)& owner) {
+    Handle(Prs3d_Presentation) presentation = GetHilightPresentation(manager);
+    if (presentation.IsNull()) return;
+
+    presentation->Clear();
+    SelectMgr_SequenceOfOwner owners;
+    owners.Append(owner);
+    addHighlight(presentation, style, owners);
+
+    presentation->SetZLayer(style->ZLayer() != Graphic3d_ZLayerId_UNKNOWN ? style->ZLayer() : ZLayer());
+    if (manager->IsImmediateModeOn()) {
+        manager->AddToImmediateList(presentation);
+    } else {
+        presentation->Display();
+    }
+}
+
+void SketchPresentation::HilightSelected(const Handle(PrsMgr_PresentationManager)& manager,
+                                         const SelectMgr_SequenceOfOwner& owners) {
+    Handle(Prs3d_Presentation) presentation = GetSelectPresentation(manager);
+    if (presentation.IsNull() || owners.IsEmpty()) return;
+
+    Handle(Prs3d_Drawer) style = HilightAttributes();
+    if (!GetContext().IsNull()) {
+        style = GetContext()->HighlightStyle(Prs3d_TypeOfHighlight_Selected);
+    }
+
+    presentation->Clear();
+    addHighlight(presentation, style, owners);
+    presentation->SetZLayer(style->ZLayer() != Graphic3d_ZLayerId_UNKNOWN ? style->ZLayer() : ZLayer());
+    presentation->Display();
+}
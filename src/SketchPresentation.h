@@ -0,0 +1,84 @@
+#ifndef SKETCHPRESENTATION_H
+#define SKETCHPRESENTATION_H
+
+#include <AIS_InteractiveObject.hxx>
+#include <SelectMgr_EntityOwner.hxx>
+#include <Graphic3d_ArrayOfPolylines.hxx>
+#include <gp_Pnt.hxx>
+
+#include <QVector>
+
+#include "CustomPlane.h"
+#include "SketchPolyline.h"
+
+// Picks one segment of a SketchPresentation in SelectSegments mode
+class SketchSegmentOwner : public SelectMgr_EntityOwner {
+public:
+    SketchSegmentOwner(const Handle(SelectMgr_SelectableObject)& sketch,
+                       int polyline, int segment);
+
+    int polylineIndex() const { return m_polyline; }
+    // Segment i joins points i and i + 1 of the polyline
+    int segmentIndex() const { return m_segment; }
+
+    DEFINE_STANDARD_RTTIEXT(SketchSegmentOwner, SelectMgr_EntityOwner)
+
+private:
+    int m_polyline;
+    int m_segment;
+};
+
+DEFINE_STANDARD_HANDLE(SketchSegmentOwner, SelectMgr_EntityOwner)
+
+// All polylines of a sketch as one interactive object: a single polyline
+// primitive array drawn in one call, instead of one AIS_Shape per wire.
+// Sensitive entities are only built when a selection mode is activated;
+// per-segment owners exist only while SelectSegments is active.
+class SketchPresentation : public AIS_InteractiveObject {
+public:
+    enum SelectionMode {
+        SelectWhole = 0,
+        SelectSegments = 1
+    };
+
+    SketchPresentation(const SketchPolylineSet& polylines, const CustomPlane& plane);
+
+    int polylineCount() const { return m_offsets.isEmpty() ? 0 : m_offsets.size() - 1; }
+    int segmentCount() const;
+
+    void SetColor(const Quantity_Color& color) Standard_OVERRIDE;
+    void SetWidth(const Standard_Real width) Standard_OVERRIDE;
+
+    Standard_Boolean AcceptDisplayMode(const Standard_Integer mode) const Standard_OVERRIDE { return mode == 0; }
+
+    void HilightOwnerWithColor(const Handle(PrsMgr_PresentationManager)& manager,
+                               const Handle(Prs3d_Drawer)& style,
+                               const Handle(SelectMgr_EntityOwner)& owner) Standard_OVERRIDE;
+    void HilightSelected(const Handle(PrsMgr_PresentationManager)& manager,
+                         const SelectMgr_SequenceOfOwner& owners) Standard_OVERRIDE;
+
+    DEFINE_STANDARD_RTTIEXT(SketchPresentation, AIS_InteractiveObject)
+
+protected:
+    void Compute(const Handle(PrsMgr_PresentationManager)& manager,
+                 const Handle(Prs3d_Presentation)& presentation,
+                 const Standard_Integer mode) Standard_OVERRIDE;
+    void ComputeSelection(const Handle(SelectMgr_Selection)& selection,
+                          const Standard_Integer mode) Standard_OVERRIDE;
+
+private:
+    Handle(Graphic3d_ArrayOfPolylines) makeArray() const;
+    void addHighlight(const Handle(Prs3d_Presentation)& presentation,
+                      const Handle(Prs3d_Drawer)& style,
+                      const SelectMgr_SequenceOfOwner& owners) const;
+
+    // World-space points and the sketch's offset table, converted once
+    QVector<gp_Pnt> m_points;
+    QVector<int> m_offsets;
+    double m_min[3];
+    double m_max[3];
+};
+
+DEFINE_STANDARD_HANDLE(SketchPresentation, AIS_InteractiveObject)
+
+#endif
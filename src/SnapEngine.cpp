@@ -0,0 +1,340 @@
+#include "SnapEngine.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    double perimeter(const double* box) {
+        return 2.0 * ((box[2] - box[0]) + (box[3] - box[1]));
+    }
+
+    void unite(const double* a, const double* b, double* out) {
+        out[0] = qMin(a[0], b[0]);
+        out[1] = qMin(a[1], b[1]);
+        out[2] = qMax(a[2], b[2]);
+        out[3] = qMax(a[3], b[3]);
+    }
+
+    bool overlaps(const double* a, const double* b) {
+        return a[0] <= b[2] && b[0] <= a[2] && a[1] <= b[3] && b[1] <= a[3];
+    }
+
+    // Lower value wins when several snap types are in range
+    int priority(SnapEngine::SnapType type) {
+        switch (type) {
+        case SnapEngine::Endpoint: return 0;
+        case SnapEngine::Intersection: return 1;
+        case SnapEngine::Midpoint: return 2;
+        case SnapEngine::Perpendicular: return 3;
+        case SnapEngine::Nearest: return 4;
+        default: return 5;
+        }
+    }
+
+    struct Best {
+        SnapEngine::Snap snap;
+        double distance;
+
+        void offer(SnapEngine::SnapType type, double u, double v,
+                   double cu, double cv, double radius) {
+            double d = std::hypot(u - cu, v - cv);
+            if (d > radius) return;
+            if (snap.type != SnapEngine::None) {
+                int p = priority(type), q = priority(snap.type);
+                if (p > q || (p == q && d >= distance)) return;
+            }
+            snap.type = type;
+            snap.u = u;
+            snap.v = v;
+            distance = d;
+        }
+    };
+}
+
+SnapEngine::SnapEngine() : m_root(-1), m_polylineCount(0) {
+}
+
+void SnapEngine::clear() {
+    m_segments.clear();
+    m_nodes.clear();
+    m_root = -1;
+    m_polylineCount = 0;
+}
+
+void SnapEngine::setPolylines(const SketchPolylineSet& polylines) {
+    clear();
+    int segments = qMax(0, polylines.pointCount() - polylines.polylineCount());
+    m_segments.reserve(4 * segments);
+    // Leaves first, then at most segments - 1 inner nodes
+    m_nodes.reserve(qMax(0, 2 * segments - 1));
+    for (int k = 0; k < polylines.polylineCount(); ++k) {
+        SketchPolylineView view = polylines.polyline(k);
+        appendSegments(view.xy, view.pointCount, false);
+    }
+
+    int leafCount = m_nodes.size();
+    if (leafCount == 0) return;
+    QVector<int> leaves(leafCount);
+    for (int i = 0; i < leafCount; ++i) leaves[i] = i;
+    m_root = buildSubtree(leaves.data(), leafCount, -1);
+}
+
+void SnapEngine::appendPolyline(const double* xy, int numPoints) {
+    appendSegments(xy, numPoints, true);
+}
+
+void SnapEngine::appendSegments(const double* xy, int numPoints, bool insert) {
+    ++m_polylineCount;
+    for (int i = 0; i + 1 < numPoints; ++i) {
+        const double* p = xy + 2 * i;
+        int index = segmentCount();
+        m_segments << p[0] << p[1] << p[2] << p[3];
+
+        Node leaf;
+        leaf.box[0] = qMin(p[0], p[2]);
+        leaf.box[1] = qMin(p[1], p[3]);
+        leaf.box[2] = qMax(p[0], p[2]);
+        leaf.box[3] = qMax(p[1], p[3]);
+        leaf.parent = -1;
+        leaf.left = -1;
+        leaf.right = -1;
+        leaf.segment = index;
+        leaf.height = 0;
+        m_nodes.append(leaf);
+        if (insert) insertLeaf(m_nodes.size() - 1);
+    }
+}
+
+int SnapEngine::buildSubtree(int* leaves, int count, int parent) {
+    if (count == 1) {
+        m_nodes[leaves[0]].parent = parent;
+        return leaves[0];
+    }
+
+    // Split at the median centre along the wider extent of the centres
+    double lo[2] = { m_nodes[leaves[0]].box[0] + m_nodes[leaves[0]].box[2],
+                     m_nodes[leaves[0]].box[1] + m_nodes[leaves[0]].box[3] };
+    double hi[2] = { lo[0], lo[1] };
+    for (int i = 1; i < count; ++i) {
+        const double* box = m_nodes[leaves[i]].box;
+        for (int axis = 0; axis < 2; ++axis) {
+            double centre = box[axis] + box[axis + 2];
+            lo[axis] = qMin(lo[axis], centre);
+            hi[axis] = qMax(hi[axis], centre);
+        }
+    }
+    int axis = (hi[0] - lo[0] >= hi[1] - lo[1]) ? 0 : 1;
+    int half = count / 2;
+    std::nth_element(leaves, leaves + half, leaves + count, [this, axis](int a, int b) {
+        return m_nodes[a].box[axis] + m_nodes[a].box[axis + 2]
+             < m_nodes[b].box[axis] + m_nodes[b].box[axis + 2];
+    });
+
+    Node inner;
+    inner.parent = parent;
+    inner.left = -1;
+    inner.right = -1;
+    inner.segment = -1;
+    inner.height = 0;
+    m_nodes.append(inner);
+    int index = m_nodes.size() - 1;
+
+    // Indices only: appending may move the nodes
+    int left = buildSubtree(leaves, half, index);
+    int right = buildSubtree(leaves + half, count - half, index);
+    m_nodes[index].left = left;
+    m_nodes[index].right = right;
+    refit(index);
+    return index;
+}
+
+void SnapEngine::insertLeaf(int leaf) {
+    if (m_root < 0) {
+        m_root = leaf;
+        return;
+    }
+
+    // Descend toward the sibling that grows the total perimeter least
+    const double* box = m_nodes[leaf].box;
+    int index = m_root;
+    while (m_nodes[index].segment < 0) {
+        const Node& node = m_nodes[index];
+        double combined[4];
+        unite(node.box, box, combined);
+        double cost = 2.0 * perimeter(combined);
+        double inheritance = 2.0 * (perimeter(combined) - perimeter(node.box));
+
+        double childCost[2];
+        const int children[2] = { node.left, node.right };
+        for (int c = 0; c < 2; ++c) {
+            const Node& child = m_nodes[children[c]];
+            double merged[4];
+            unite(child.box, box, merged);
+            childCost[c] = perimeter(merged) + inheritance;
+            if (child.segment < 0) childCost[c] -= perimeter(child.box);
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) break;
+        index = childCost[0] < childCost[1] ? node.left : node.right;
+    }
+
+    // New inner node replaces the sibling in the tree
+    int sibling = index;
+    int oldParent = m_nodes[sibling].parent;
+    Node inner;
+    inner.parent = oldParent;
+    inner.left = sibling;
+    inner.right = leaf;
+    inner.segment = -1;
+    inner.height = 0;
+    m_nodes.append(inner);
+    int innerIndex = m_nodes.size() - 1;
+
+    m_nodes[sibling].parent = innerIndex;
+    m_nodes[leaf].parent = innerIndex;
+    if (oldParent < 0) {
+        m_root = innerIndex;
+    } else if (m_nodes[oldParent].left == sibling) {
+        m_nodes[oldParent].left = innerIndex;
+    } else {
+        m_nodes[oldParent].right = innerIndex;
+    }
+
+    // Refit the ancestors, rotating where one side got too tall
+    for (int i = innerIndex; i >= 0; i = m_nodes[i].parent) {
+        i = balance(i);
+        refit(i);
+    }
+}
+
+void SnapEngine::refit(int index) {
+    Node& node = m_nodes[index];
+    const Node& left = m_nodes[node.left];
+    const Node& right = m_nodes[node.right];
+    unite(left.box, right.box, node.box);
+    node.height = 1 + qMax(left.height, right.height);
+}
+
+// Rotates the taller child of index up when the child heights differ by
+// more than one, as in an AVL tree; returns the node now in its place
+int SnapEngine::balance(int index) {
+    const Node& node = m_nodes[index];
+    if (node.segment >= 0 || node.height < 2) return index;
+
+    int difference = m_nodes[node.right].height - m_nodes[node.left].height;
+    if (difference >= -1 && difference <= 1) return index;
+
+    int up = difference > 1 ? node.right : node.left;
+    int stay = difference > 1 ? node.left : node.right;
+    int parent = node.parent;
+
+    // The taller grandchild stays under up, the shorter one moves down
+    // to index in up's place
+    int first = m_nodes[up].left;
+    int second = m_nodes[up].right;
+    int keep = m_nodes[first].height >= m_nodes[second].height ? first : second;
+    int move = keep == first ? second : first;
+
+    m_nodes[up].parent = parent;
+    if (parent < 0) {
+        m_root = up;
+    } else if (m_nodes[parent].left == index) {
+        m_nodes[parent].left = up;
+    } else {
+        m_nodes[parent].right = up;
+    }
+
+    m_nodes[index].left = stay;
+    m_nodes[index].right = move;
+    m_nodes[index].parent = up;
+    m_nodes[move].parent = index;
+    m_nodes[up].left = index;
+    m_nodes[up].right = keep;
+
+    refit(index);
+    refit(up);
+    return up;
+}
+
+void SnapEngine::collect(const double* box, QVector<int>& segments) const {
+    if (m_root < 0) return;
+
+    QVector<int> stack;
+    stack.reserve(64);
+    stack.append(m_root);
+    while (!stack.isEmpty()) {
+        const Node& node = m_nodes[stack.takeLast()];
+        if (!overlaps(node.box, box)) continue;
+
+        if (node.segment >= 0) {
+            segments.append(node.segment);
+        } else {
+            stack.append(node.left);
+            stack.append(node.right);
+        }
+    }
+}
+
+SnapEngine::Snap SnapEngine::query(double u, double v, double radius, int types,
+                                   const double* from) const {
+    Best best;
+    best.snap.type = None;
+    best.snap.u = u;
+    best.snap.v = v;
+    best.distance = 0.0;
+
+    const double box[4] = { u - radius, v - radius, u + radius, v + radius };
+    QVector<int> candidates;
+    collect(box, candidates);
+
+    for (int index : candidates) {
+        const double* s = segment(index);
+        double du = s[2] - s[0];
+        double dv = s[3] - s[1];
+        double lengthSq = du * du + dv * dv;
+
+        if (types & Endpoint) {
+            best.offer(Endpoint, s[0], s[1], u, v, radius);
+            best.offer(Endpoint, s[2], s[3], u, v, radius);
+        }
+        if (types & Midpoint) {
+            best.offer(Midpoint, 0.5 * (s[0] + s[2]), 0.5 * (s[1] + s[3]), u, v, radius);
+        }
+        if (lengthSq <= 0.0) continue;
+
+        if (types & Nearest) {
+            double t = qBound(0.0, ((u - s[0]) * du + (v - s[1]) * dv) / lengthSq, 1.0);
+            best.offer(Nearest, s[0] + t * du, s[1] + t * dv, u, v, radius);
+        }
+        if ((types & Perpendicular) && from) {
+            double t = ((from[0] - s[0]) * du + (from[1] - s[1]) * dv) / lengthSq;
+            if (t >= 0.0 && t <= 1.0) {
+                best.offer(Perpendicular, s[0] + t * du, s[1] + t * dv, u, v, radius);
+            }
+        }
+    }
+
+    // Crossings only among segments near the cursor
+    if (types & Intersection) {
+        for (int i = 0; i < candidates.size(); ++i) {
+            const double* a = segment(candidates[i]);
+            double adu = a[2] - a[0], adv = a[3] - a[1];
+            for (int j = i + 1; j < candidates.size(); ++j) {
+                const double* b = segment(candidates[j]);
+                double bdu = b[2] - b[0], bdv = b[3] - b[1];
+                double denom = adu * bdv - adv * bdu;
+                if (std::abs(denom) <= 1.0e-12 * (std::abs(adu * bdv) + std::abs(adv * bdu))) continue;
+
+                double wu = b[0] - a[0], wv = b[1] - a[1];
+                double t = (wu * bdv - wv * bdu) / denom;
+                double s = (wu * adv - wv * adu) / denom;
+                if (t < 0.0 || t > 1.0 || s < 0.0 || s > 1.0) continue;
+                best.offer(Intersection, a[0] + t * adu, a[1] + t * adv, u, v, radius);
+            }
+        }
+    }
+
+    return best.snap;
+}
@@ -0,0 +1,79 @@
+#ifndef SNAPENGINE_H
+#define SNAPENGINE_H
+
+#include <QVector>
+
+#include "SketchPolyline.h"
+
+// Object snaps on the segments of one sketch, in plane coordinates.
+// Segments live in an AABB tree (2D BVH). setPolylines builds it top-down
+// with median splits; appended polylines are inserted and rebalanced with
+// AVL-style rotations, so even the spatially ordered segments of a long
+// polyline keep the height at O(log n). Appending a polyline costs
+// O(k log n) and a query only visits the segments near the cursor.
+class SnapEngine {
+public:
+    enum SnapType {
+        None = 0,
+        Endpoint = 1,
+        Midpoint = 2,
+        Intersection = 4,
+        Perpendicular = 8,
+        Nearest = 16,
+        AllSnaps = 31
+    };
+
+    struct Snap {
+        SnapType type;
+        double u;
+        double v;
+    };
+
+    SnapEngine();
+
+    void clear();
+    // Replaces the content with all polylines of a sketch
+    void setPolylines(const SketchPolylineSet& polylines);
+    void appendPolyline(const double* xy, int numPoints);
+
+    int polylineCount() const { return m_polylineCount; }
+    int segmentCount() const { return m_segments.size() / 4; }
+    // Edges on the longest path from the root to a segment
+    int treeHeight() const { return m_root < 0 ? 0 : m_nodes[m_root].height; }
+
+    // Best snap of the enabled types within radius of (u, v). Types are
+    // preferred in the order endpoint, intersection, midpoint,
+    // perpendicular, nearest; ties go to the closest candidate.
+    // Perpendicular needs the previous point in from (u, v pair).
+    Snap query(double u, double v, double radius, int types,
+               const double* from = nullptr) const;
+
+private:
+    struct Node {
+        double box[4];   // umin, vmin, umax, vmax
+        int parent;
+        int left;
+        int right;
+        int segment;     // -1 for inner nodes
+        int height;      // 0 for leaves
+    };
+
+    // Adds the segments of a polyline as leaves; insert links them into
+    // the tree, otherwise the caller builds it
+    void appendSegments(const double* xy, int numPoints, bool insert);
+    int buildSubtree(int* leaves, int count, int parent);
+    void insertLeaf(int leaf);
+    int balance(int index);
+    void refit(int index);
+    void collect(const double* box, QVector<int>& segments) const;
+    const double* segment(int index) const { return m_segments.constData() + 4 * index; }
+
+    // Segment i runs from (m_segments[4i], m_segments[4i+1]) to
+    // (m_segments[4i+2], m_segments[4i+3])
+    QVector<double> m_segments;
+    QVector<Node> m_nodes;
+    int m_root;
+    int m_polylineCount;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "Tessellator.h"
+#include "LodShape.h"
+
+#include <OSD_ThreadPool.hxx>
+
+#include <QSet>
+#include <QThread>
+
+namespace {
+    // One shape per call; each shape is meshed by exactly one thread
+    struct MeshFunctor {
+        const QVector<TopoDS_Shape>* shapes;
+
+        void operator()(int threadIndex, int index) const {
+            (void)threadIndex;
+            LodShape::meshCoarsestLevel((*shapes)[index], false);
+        }
+    };
+}
+
+Tessellator::Tessellator(QObject* parent)
+    : QObject(parent)
+    , m_thread(nullptr)
+{
+}
+
+Tessellator::~Tessellator() {
+    if (m_thread) {
+        m_thread->disconnect(this);
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void Tessellator::wait() {
+    if (m_thread) m_thread->wait();
+}
+
+void Tessellator::meshShapes(const QVector<TopoDS_Shape>& input) {
+    // Cached shapes are shared between features; two threads must never
+    // mesh the same faces
+    QVector<TopoDS_Shape> shapes;
+    QSet<const void*> seen;
+    for (const TopoDS_Shape& shape : input) {
+        if (shape.IsNull()) continue;
+        const void* tshape = shape.TShape().get();
+        if (seen.contains(tshape)) continue;
+        seen.insert(tshape);
+        shapes.append(shape);
+    }
+    if (shapes.isEmpty()) return;
+
+    // A single shape is split over its faces instead
+    if (shapes.size() == 1) {
+        LodShape::meshCoarsestLevel(shapes.first(), true);
+        return;
+    }
+
+    MeshFunctor functor;
+    functor.shapes = &shapes;
+    OSD_ThreadPool::Launcher launcher(*OSD_ThreadPool::DefaultPool());
+    launcher.Perform(0, shapes.size(), functor);
+}
+
+bool Tessellator::start(const QVector<TopoDS_Shape>& shapes) {
+    if (m_thread) return false;
+
+    run(QThread::create([shapes]() { meshShapes(shapes); }), false);
+    return true;
+}
+
+bool Tessellator::startLevels(const QVector<LevelJob>& jobs) {
+    if (m_thread) return false;
+
+    // Each copy is split over its faces, one shape after the other
+    run(QThread::create([this, jobs]() {
+        QVector<LevelJob> done = jobs;
+        for (LevelJob& job : done) {
+            job.mesh = LodShape::buildLevel(job.shape, job.level, job.diagonal);
+        }
+        m_levels = done;
+    }), true);
+    return true;
+}
+
+QVector<Tessellator::LevelJob> Tessellator::takeLevels() {
+    QVector<LevelJob> levels;
+    levels.swap(m_levels);
+    return levels;
+}
+
+void Tessellator::run(QThread* thread, bool levels) {
+    m_thread = thread;
+    connect(m_thread, &QThread::finished, this, [this, levels]() {
+        m_thread->deleteLater();
+        m_thread = nullptr;
+        if (levels) {
+            Q_EMIT levelsMeshed();
+        } else {
+            Q_EMIT finished();
+        }
+    });
+    m_thread->start(QThread::LowPriority);
+}
@@ -0,0 +1,66 @@
+#ifndef TESSELLATOR_H
+#define TESSELLATOR_H
+
+#include <TopoDS_Shape.hxx>
+
+#include <QObject>
+#include <QVector>
+
+class QThread;
+
+// Meshes shapes before they are displayed, so the first redraw does not
+// tessellate every solid serially on the GUI thread. Shapes are meshed
+// at LodShape's coarsest level on a background thread, spread over the
+// OCCT thread pool. The triangulations stay on the shapes, so the shape
+// cache and saved documents carry them to later displays and loads.
+// Finer LodShape levels are meshed the same way on topological copies,
+// so zooming in never meshes on the GUI thread.
+//
+// Meshing writes to the document's own TShapes, which the shape cache
+// may share between features, so the GUI thread must wait() before it
+// reads or meshes document shapes while a job may be running.
+class Tessellator : public QObject {
+    Q_OBJECT
+
+public:
+    // A finer LodShape level, meshed on a copy of shape into mesh
+    struct LevelJob {
+        TopoDS_Shape shape;
+        int level;
+        double diagonal;
+        TopoDS_Shape mesh;
+    };
+
+    explicit Tessellator(QObject* parent = nullptr);
+    // Waits for a running job
+    ~Tessellator();
+
+    // Starts meshing on a worker thread; finished() is emitted in this
+    // object's thread when done. Only one job runs at a time.
+    bool start(const QVector<TopoDS_Shape>& shapes);
+    // Same for finer levels; levelsMeshed() is emitted instead and
+    // takeLevels() returns the jobs with their meshes filled in
+    bool startLevels(const QVector<LevelJob>& jobs);
+    QVector<LevelJob> takeLevels();
+    bool isRunning() const { return m_thread != nullptr; }
+    // Blocks until a running job has stopped touching its shapes;
+    // finished() still arrives through the event loop
+    void wait();
+
+    // Blocking variant for a handful of shapes. Shapes sharing a TShape
+    // are meshed once.
+    static void meshShapes(const QVector<TopoDS_Shape>& shapes);
+
+Q_SIGNALS:
+    void finished();
+    void levelsMeshed();
+
+private:
+    void run(QThread* thread, bool levels);
+
+    QThread* m_thread;
+    // Written by the worker, read once levelsMeshed() arrives
+    QVector<LevelJob> m_levels;
+};
+
+#endif
@@ -0,0 +1,23 @@
+# document.pro - unit tests for the OcafDocument feature index
+
+TEMPLATE = app
+TARGET   = tst_ocafdocument
+
+CONFIG   += console c++17 testcase
+CONFIG   -= app_bundle
+
+QT       = core gui testlib
+
+include(../../occt.pri)
+include(../../document.pri)
+
+unix {
+    QMAKE_CXXFLAGS += -Wall -Wextra
+}
+
+win32 {
+    DEFINES += _USE_MATH_DEFINES
+}
+
+SOURCES += \
+    tst_ocafdocument.cpp
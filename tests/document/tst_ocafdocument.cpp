@@ -0,0 +1,312 @@
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "OcafDocument.h"
+
+#include <TDF_ChildIterator.hxx>
+
+#include <algorithm>
+
+Q_DECLARE_METATYPE(LoadMode)
+
+namespace {
+    const double Square[] = { 0, 0, 10, 0, 10, 10, 0, 10, 0, 0 };
+
+    // Checks findFeature against a full scan of the root children; returns
+    // what differs, or an empty string. Every ID in expected must be in the
+    // tree and every ID in removed must resolve to nothing.
+    QString checkIndex(const OcafDocument& doc, QVector<int> expected, const QVector<int>& removed = {}) {
+        QVector<int> scanned;
+        for (TDF_ChildIterator it(doc.getRootLabel()); it.More(); it.Next()) {
+            int id = doc.getFeatureId(it.Value());
+            if (id < 0) continue;
+
+            scanned.append(id);
+            if (!doc.findFeature(id).IsEqual(it.Value())) {
+                return QString("findFeature(%1) does not return its label").arg(id);
+            }
+        }
+        for (int id : removed) {
+            if (!doc.findFeature(id).IsNull()) {
+                return QString("findFeature(%1) still returns a label").arg(id);
+            }
+        }
+        if (!doc.verifyFeatureIndex()) return "verifyFeatureIndex failed";
+
+        std::sort(scanned.begin(), scanned.end());
+        std::sort(expected.begin(), expected.end());
+        if (scanned != expected) {
+            QStringList ids;
+            for (int id : scanned) ids << QString::number(id);
+            return "Unexpected features in the tree: " + ids.join(", ");
+        }
+        return QString();
+    }
+
+    // One command creating a sketch with an outline and its extrude
+    void createPart(OcafDocument& doc, int index) {
+        doc.openCommand();
+        TDF_Label sketch = doc.createSketch(CustomPlane::XY(), QString("Sketch %1").arg(index));
+        doc.addPolylineToSketch(sketch, Square, 5);
+        doc.createExtrude(sketch, 5.0, QString("Extrude %1").arg(index));
+        doc.commitCommand();
+    }
+}
+
+#define CHECK_INDEX(...)                                         \
+    do {                                                         \
+        QString mismatch = checkIndex(__VA_ARGS__);              \
+        QVERIFY2(mismatch.isEmpty(), qPrintable(mismatch));      \
+    } while (false)
+
+class OcafDocumentTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void create();
+    void undoRedo();
+    void abortCommand();
+    void abortBatch();
+    void load_data();
+    void load();
+    void lazyLoadMissingFile();
+    void editSequence();
+};
+
+void OcafDocumentTest::create() {
+    OcafDocument doc;
+    QVERIFY(doc.newDocument());
+    CHECK_INDEX(doc, {}, { 1 });
+
+    createPart(doc, 0);
+    CHECK_INDEX(doc, { 1, 2 });
+    createPart(doc, 1);
+    CHECK_INDEX(doc, { 1, 2, 3, 4 });
+
+    QVERIFY(doc.getExtrudeSketch(doc.findFeature(4)).IsEqual(doc.findFeature(3)));
+    QVERIFY(doc.getFeatureType(doc.findFeature(3)) == FeatureType::Sketch);
+    QCOMPARE(doc.getFeatureName(doc.findFeature(4)), QString("Extrude 1"));
+    QVERIFY(doc.findFeature(0).IsNull());
+    QVERIFY(doc.findFeature(-1).IsNull());
+
+    // A new document starts a new index
+    QVERIFY(doc.newDocument());
+    CHECK_INDEX(doc, {}, { 1, 2, 3, 4 });
+}
+
+void OcafDocumentTest::undoRedo() {
+    OcafDocument doc;
+    QVERIFY(doc.newDocument());
+    createPart(doc, 0);
+    createPart(doc, 1);
+
+    // Undoing a create deletes its features
+    QVERIFY(doc.undo());
+    CHECK_INDEX(doc, { 1, 2 }, { 3, 4 });
+    QVERIFY(doc.undo());
+    CHECK_INDEX(doc, {}, { 1, 2, 3, 4 });
+    QVERIFY(!doc.undo());
+
+    QVERIFY(doc.redo());
+    CHECK_INDEX(doc, { 1, 2 }, { 3, 4 });
+    QVERIFY(doc.redo());
+    CHECK_INDEX(doc, { 1, 2, 3, 4 });
+    QVERIFY(!doc.redo());
+
+    // An ID that redo could bring back is not handed out again, even
+    // once the new command has dropped the redo
+    QVERIFY(doc.undo());
+    createPart(doc, 2);
+    CHECK_INDEX(doc, { 1, 2, 5, 6 }, { 3, 4 });
+    QVERIFY(!doc.canRedo());
+    QCOMPARE(doc.getFeatureName(doc.findFeature(6)), QString("Extrude 2"));
+}
+
+void OcafDocumentTest::abortCommand() {
+    OcafDocument doc;
+    QVERIFY(doc.newDocument());
+    createPart(doc, 0);
+
+    doc.openCommand();
+    TDF_Label sketch = doc.createSketch(CustomPlane::XZ(), "Aborted");
+    // Visible to findFeature while the command is open
+    CHECK_INDEX(doc, { 1, 2, 3 });
+    doc.createExtrude(sketch, 1.0, "Aborted extrude");
+    CHECK_INDEX(doc, { 1, 2, 3, 4 });
+    doc.abortCommand();
+    CHECK_INDEX(doc, { 1, 2 }, { 3, 4 });
+
+    // Aborting leaves the earlier commands alone
+    QVERIFY(doc.undo());
+    CHECK_INDEX(doc, {}, { 1, 2 });
+    QVERIFY(doc.redo());
+    CHECK_INDEX(doc, { 1, 2 });
+}
+
+void OcafDocumentTest::abortBatch() {
+    OcafDocument doc;
+    QVERIFY(doc.newDocument());
+    createPart(doc, 0);
+
+    doc.beginBatch();
+    doc.createSketch(CustomPlane::XY(), "Outer");
+    doc.beginBatch();
+    doc.createSketch(CustomPlane::YZ(), "Inner");
+    QVERIFY(doc.endBatch());
+    CHECK_INDEX(doc, { 1, 2, 3, 4 });
+    // The inner batch ended, aborting the outer one drops both
+    QVERIFY(!doc.abortBatch());
+    QVERIFY(!doc.inBatch());
+    CHECK_INDEX(doc, { 1, 2 }, { 3, 4 });
+
+    doc.beginBatch();
+    TDF_Label sketch = doc.createSketch(CustomPlane::XY(), "Batched");
+    doc.addPolylineToSketch(sketch, Square, 5);
+    doc.beginBatch();
+    doc.createExtrude(sketch, 2.0, "Batched extrude");
+    QVERIFY(doc.endBatch());
+    QVERIFY(doc.endBatch());
+    CHECK_INDEX(doc, { 1, 2, 5, 6 });
+    QVERIFY(doc.undo());
+    CHECK_INDEX(doc, { 1, 2 }, { 5, 6 });
+}
+
+void OcafDocumentTest::load_data() {
+    QTest::addColumn<LoadMode>("mode");
+    QTest::newRow("full") << LoadMode::Full;
+    QTest::newRow("lazy") << LoadMode::Lazy;
+}
+
+void OcafDocumentTest::load() {
+    QFETCH(LoadMode, mode);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("features.ocaf");
+
+    {
+        OcafDocument doc;
+        QVERIFY(doc.newDocument());
+        for (int i = 0; i < 4; ++i) createPart(doc, i);
+        // Leave a gap in the IDs
+        QVERIFY(doc.undo());
+        QVERIFY(doc.undo());
+        createPart(doc, 4);
+        CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10 }, { 5, 6, 7, 8 });
+        QVERIFY(doc.saveDocument(path));
+    }
+
+    OcafDocument doc;
+    QVERIFY(doc.loadDocument(path, mode));
+    CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10 }, { 5, 6, 7, 8 });
+    QVERIFY(doc.getExtrudeSketch(doc.findFeature(10)).IsEqual(doc.findFeature(9)));
+    QCOMPARE(doc.getFeatureName(doc.findFeature(10)), QString("Extrude 4"));
+    QCOMPARE(doc.getExtrudeHeight(doc.findFeature(2)), 5.0);
+
+    // New features continue after the highest stored ID
+    createPart(doc, 5);
+    CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10, 11, 12 });
+    QVERIFY(doc.undo());
+    CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10 }, { 11, 12 });
+
+    // Loading again replaces the index
+    QVERIFY(doc.loadDocument(path, mode));
+    CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10 }, { 11, 12 });
+    if (mode == LoadMode::Lazy) {
+        QVERIFY(doc.materialize(doc.getFeatures()));
+        CHECK_INDEX(doc, { 1, 2, 3, 4, 9, 10 });
+    }
+}
+
+void OcafDocumentTest::lazyLoadMissingFile() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString path = dir.filePath("features.ocaf");
+    QString moved = dir.filePath("moved.ocaf");
+
+    {
+        OcafDocument doc;
+        QVERIFY(doc.newDocument());
+        createPart(doc, 0);
+        QVERIFY(doc.saveDocument(path));
+    }
+
+    OcafDocument doc;
+    QVERIFY(doc.loadDocument(path, LoadMode::Lazy));
+    TDF_Label sketch = doc.findFeature(1);
+    QVERIFY(!doc.isMaterialized(sketch));
+
+    // With the file gone nothing may be appended over the stored geometry
+    QVERIFY(QFile::rename(path, moved));
+    doc.openCommand();
+    QVERIFY(!doc.addPolylineToSketch(sketch, Square, 5));
+    doc.commitCommand();
+    QVERIFY(!doc.isMaterialized(sketch));
+    QVERIFY(!doc.materialize(doc.getFeatures()));
+    QVERIFY(!doc.saveDocument(dir.filePath("copy.ocaf")));
+
+    // Once it is back, the stored polyline is read and the new one appended
+    QVERIFY(QFile::rename(moved, path));
+    QVERIFY(doc.materialize(QVector<TDF_Label>() << sketch));
+    QVERIFY(doc.isMaterialized(sketch));
+    QCOMPARE(doc.getSketchPolylines(sketch).polylineCount(), 1);
+    doc.openCommand();
+    QVERIFY(doc.addPolylineToSketch(sketch, Square, 5));
+    doc.commitCommand();
+    QCOMPARE(doc.getSketchPolylines(sketch).polylineCount(), 2);
+}
+
+void OcafDocumentTest::editSequence() {
+    // A fixed mix of creates, undos, redos and aborts, checked after every step
+    OcafDocument doc;
+    QVERIFY(doc.newDocument());
+
+    QVector<int> live;
+    // IDs per undone command, last undone last, and IDs gone for good
+    QVector<QVector<int>> undone;
+    QVector<int> gone;
+    int nextId = 1;
+    quint32 seed = 12345;
+
+    for (int step = 0; step < 300; ++step) {
+        seed = seed * 1103515245u + 12345u;
+        int action = (seed >> 16) % 10;
+
+        if (action < 5) {
+            createPart(doc, step);
+            live << nextId << nextId + 1;
+            nextId += 2;
+            for (const QVector<int>& ids : undone) gone += ids;
+            undone.clear();
+        } else if (action < 7) {
+            // The oldest commands fall off at the undo limit
+            if (!doc.canUndo()) continue;
+            QVERIFY(doc.undo());
+            undone.append(live.mid(live.size() - 2));
+            live.resize(live.size() - 2);
+        } else if (action < 9) {
+            if (!doc.canRedo()) continue;
+            QVERIFY(!undone.isEmpty());
+            QVERIFY(doc.redo());
+            live += undone.takeLast();
+        } else {
+            doc.openCommand();
+            doc.createSketch(CustomPlane::XY(), "Aborted");
+            doc.abortCommand();
+            // The aborted ID is not reused
+            gone << nextId++;
+            if (!doc.canRedo()) {
+                for (const QVector<int>& ids : undone) gone += ids;
+                undone.clear();
+            }
+        }
+
+        QVector<int> removed = gone;
+        for (const QVector<int>& ids : undone) removed += ids;
+        CHECK_INDEX(doc, live, removed);
+    }
+}
+
+QTEST_GUILESS_MAIN(OcafDocumentTest)
+
+#include "tst_ocafdocument.moc"
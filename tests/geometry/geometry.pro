@@ -0,0 +1,23 @@
+# geometry.pro - unit tests for CustomPlane and FeatureBuilder
+
+TEMPLATE = app
+TARGET   = tst_geometry
+
+CONFIG   += console c++17 testcase
+CONFIG   -= app_bundle
+
+QT       = core gui testlib
+
+include(../../occt.pri)
+include(../../geometry.pri)
+
+unix {
+    QMAKE_CXXFLAGS += -Wall -Wextra
+}
+
+win32 {
+    DEFINES += _USE_MATH_DEFINES
+}
+
+SOURCES += \
+    tst_geometry.cpp
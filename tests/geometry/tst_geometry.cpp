@@ -0,0 +1,216 @@
+#include <QtTest>
+
+#include "CustomPlane.h"
+#include "FeatureBuilder.h"
+#include "SketchPolyline.h"
+
+#include <BRepBndLib.hxx>
+#include <BRepGProp.hxx>
+#include <Bnd_Box.hxx>
+#include <GProp_GProps.hxx>
+#include <Precision.hxx>
+#include <TopAbs_ShapeEnum.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+
+namespace {
+    const double Tolerance = 1e-6;
+
+    bool near(double a, double b) {
+        return qAbs(a - b) < Tolerance;
+    }
+
+    bool near(const gp_Pnt& p, double x, double y, double z) {
+        return near(p.X(), x) && near(p.Y(), y) && near(p.Z(), z);
+    }
+
+    int count(const TopoDS_Shape& shape, TopAbs_ShapeEnum type) {
+        TopTools_IndexedMapOfShape map;
+        TopExp::MapShapes(shape, type, map);
+        return map.Extent();
+    }
+
+    double volume(const TopoDS_Shape& shape) {
+        GProp_GProps props;
+        BRepGProp::VolumeProperties(shape, props);
+        return qAbs(props.Mass());
+    }
+
+    SketchPolylineSet polylines(std::initializer_list<double> xy) {
+        SketchPolylineSet set;
+        QVector<double> points(xy);
+        set.append(points.constData(), points.size() / 2);
+        return set;
+    }
+}
+
+class GeometryTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void standardPlanes();
+    void displayNames();
+    void toWorld();
+    void toGpAx2();
+    void extrudeSquare();
+    void extrudeTriangle();
+    void extrudeOnXZ();
+    void extrudeOffsetPlane();
+    void extrudeClosedOutline();
+    void extrudeDegenerate();
+    void polylineEdges();
+};
+
+void GeometryTest::standardPlanes() {
+    CustomPlane xy = CustomPlane::XY();
+    QCOMPARE(xy.normal, QVector3D(0, 0, 1));
+    QCOMPARE(xy.uAxis, QVector3D(1, 0, 0));
+    QCOMPARE(xy.vAxis, QVector3D(0, 1, 0));
+
+    CustomPlane xz = CustomPlane::XZ();
+    QCOMPARE(xz.normal, QVector3D(0, 1, 0));
+    QCOMPARE(xz.uAxis, QVector3D(1, 0, 0));
+    QCOMPARE(xz.vAxis, QVector3D(0, 0, 1));
+
+    CustomPlane yz = CustomPlane::YZ();
+    QCOMPARE(yz.normal, QVector3D(1, 0, 0));
+    QCOMPARE(yz.uAxis, QVector3D(0, 1, 0));
+    QCOMPARE(yz.vAxis, QVector3D(0, 0, 1));
+
+    for (const CustomPlane& plane : { xy, xz, yz }) {
+        QCOMPARE(plane.origin, QVector3D(0, 0, 0));
+        QVERIFY(qFuzzyIsNull(QVector3D::dotProduct(plane.uAxis, plane.vAxis)));
+        QVERIFY(qFuzzyIsNull(QVector3D::dotProduct(plane.uAxis, plane.normal)));
+        QVERIFY(qFuzzyIsNull(QVector3D::dotProduct(plane.vAxis, plane.normal)));
+    }
+}
+
+void GeometryTest::displayNames() {
+    QCOMPARE(CustomPlane::XY().getDisplayName(), QString("XY"));
+    QCOMPARE(CustomPlane::XZ().getDisplayName(), QString("XZ"));
+    QCOMPARE(CustomPlane::YZ().getDisplayName(), QString("YZ"));
+
+    // An offset standard plane is no longer the standard one
+    CustomPlane offset = CustomPlane::XY();
+    offset.origin = QVector3D(0, 0, 10);
+    QCOMPARE(offset.getDisplayName(), QString("Custom (0.00, 0.00, 1.00)"));
+}
+
+void GeometryTest::toWorld() {
+    QVERIFY(near(CustomPlane::XY().toWorld(2, 3), 2, 3, 0));
+    QVERIFY(near(CustomPlane::XZ().toWorld(2, 3), 2, 0, 3));
+    QVERIFY(near(CustomPlane::YZ().toWorld(2, 3), 0, 2, 3));
+
+    CustomPlane offset = CustomPlane::XY();
+    offset.origin = QVector3D(1, -1, 10);
+    QVERIFY(near(offset.toWorld(2, 3), 3, 2, 10));
+
+    // Evaluated in double precision, past what QVector3D would keep
+    QVERIFY(near(CustomPlane::XY().toWorld(1.0e6 + 1.0e-4, 0), 1.0e6 + 1.0e-4, 0, 0));
+}
+
+void GeometryTest::toGpAx2() {
+    gp_Ax2 ax = CustomPlane::XZ().toGpAx2();
+    QVERIFY(ax.Direction().IsEqual(gp_Dir(0, 1, 0), Precision::Angular()));
+    QVERIFY(ax.XDirection().IsEqual(gp_Dir(1, 0, 0), Precision::Angular()));
+
+    gp_Pln pln = CustomPlane::YZ().toGpPln();
+    QVERIFY(pln.Axis().Direction().IsEqual(gp_Dir(1, 0, 0), Precision::Angular()));
+    QVERIFY(near(pln.Location(), 0, 0, 0));
+}
+
+void GeometryTest::extrudeSquare() {
+    TopoDS_Shape shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 1, 0, 1, 1, 0, 1 }), CustomPlane::XY(), 5.0);
+    QVERIFY(!shape.IsNull());
+    QCOMPARE(count(shape, TopAbs_SOLID), 1);
+    QCOMPARE(count(shape, TopAbs_FACE), 6);
+    QCOMPARE(count(shape, TopAbs_EDGE), 12);
+    QVERIFY(near(volume(shape), 5.0));
+
+    Bnd_Box box;
+    BRepBndLib::Add(shape, box);
+    box.SetGap(0.0);
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    QVERIFY(near(gp_Pnt(xmin, ymin, zmin), 0, 0, 0));
+    QVERIFY(near(gp_Pnt(xmax, ymax, zmax), 1, 1, 5));
+}
+
+void GeometryTest::extrudeTriangle() {
+    TopoDS_Shape shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 4, 0, 0, 3 }), CustomPlane::XY(), 2.0);
+    QVERIFY(!shape.IsNull());
+    QCOMPARE(count(shape, TopAbs_FACE), 5);
+    QVERIFY(near(volume(shape), 12.0));
+}
+
+void GeometryTest::extrudeOnXZ() {
+    // Plane (u, v) maps to world (x, z); the prism grows along +Y
+    TopoDS_Shape shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 2, 0, 2, 3, 0, 3 }), CustomPlane::XZ(), 4.0);
+    QVERIFY(!shape.IsNull());
+    QVERIFY(near(volume(shape), 24.0));
+
+    Bnd_Box box;
+    BRepBndLib::Add(shape, box);
+    box.SetGap(0.0);
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    QVERIFY(near(gp_Pnt(xmin, ymin, zmin), 0, 0, 0));
+    QVERIFY(near(gp_Pnt(xmax, ymax, zmax), 2, 4, 3));
+}
+
+void GeometryTest::extrudeOffsetPlane() {
+    CustomPlane plane = CustomPlane::XY();
+    plane.origin = QVector3D(10, 20, 30);
+    TopoDS_Shape shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 1, 0, 1, 1, 0, 1 }), plane, 2.0);
+    QVERIFY(!shape.IsNull());
+    QVERIFY(near(volume(shape), 2.0));
+
+    Bnd_Box box;
+    BRepBndLib::Add(shape, box);
+    box.SetGap(0.0);
+    double xmin, ymin, zmin, xmax, ymax, zmax;
+    box.Get(xmin, ymin, zmin, xmax, ymax, zmax);
+    QVERIFY(near(gp_Pnt(xmin, ymin, zmin), 10, 20, 30));
+    QVERIFY(near(gp_Pnt(xmax, ymax, zmax), 11, 21, 32));
+}
+
+void GeometryTest::extrudeClosedOutline() {
+    // Sketches usually repeat the first point; the closing edge must not
+    // be doubled
+    TopoDS_Shape shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 1, 0, 1, 1, 0, 1, 0, 0 }), CustomPlane::XY(), 5.0);
+    QVERIFY(!shape.IsNull());
+    QCOMPARE(count(shape, TopAbs_FACE), 6);
+    QVERIFY(near(volume(shape), 5.0));
+
+    // Coincident points inside the outline are skipped too
+    shape = FeatureBuilder::makeExtrude(
+        polylines({ 0, 0, 1, 0, 1, 0, 1, 1, 0, 1 }), CustomPlane::XY(), 5.0);
+    QVERIFY(!shape.IsNull());
+    QCOMPARE(count(shape, TopAbs_FACE), 6);
+}
+
+void GeometryTest::extrudeDegenerate() {
+    QVERIFY(FeatureBuilder::makeExtrude(SketchPolylineSet(), CustomPlane::XY(), 5.0).IsNull());
+    QVERIFY(FeatureBuilder::makeExtrude(polylines({ 0, 0, 1, 0 }), CustomPlane::XY(), 5.0).IsNull());
+}
+
+void GeometryTest::polylineEdges() {
+    SketchPolylineSet set = polylines({ 0, 0, 1, 0, 1, 0, 1, 1, 0, 1 });
+    TopoDS_Shape wire = FeatureBuilder::makePolyline(set.polyline(0), CustomPlane::XY());
+    QVERIFY(!wire.IsNull());
+    QCOMPARE(wire.ShapeType(), TopAbs_WIRE);
+    // Open polyline, the repeated point adds no edge
+    QCOMPARE(count(wire, TopAbs_EDGE), 3);
+
+    SketchPolylineSet single = polylines({ 0, 0 });
+    QVERIFY(FeatureBuilder::makePolyline(single.polyline(0), CustomPlane::XY()).IsNull());
+}
+
+QTEST_GUILESS_MAIN(GeometryTest)
+
+#include "tst_geometry.moc"
@@ -0,0 +1,27 @@
+# snap.pro - unit tests for the SnapEngine segment tree
+
+TEMPLATE = app
+TARGET   = tst_snapengine
+
+CONFIG   += console c++17 testcase
+CONFIG   -= app_bundle
+
+QT       = core gui testlib
+
+include(../../occt.pri)
+include(../../geometry.pri)
+
+unix {
+    QMAKE_CXXFLAGS += -Wall -Wextra
+}
+
+win32 {
+    DEFINES += _USE_MATH_DEFINES
+}
+
+SOURCES += \
+    ../../src/SnapEngine.cpp \
+    tst_snapengine.cpp
+
+HEADERS += \
+    ../../src/SnapEngine.h
@@ -0,0 +1,151 @@
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include "SnapEngine.h"
+
+#include <cmath>
+
+namespace {
+    const int SegmentCount = 100000;
+
+    // One long spiral: every segment starts where the previous one ends,
+    // the ordering that degenerates a greedily built tree
+    SketchPolylineSet spiral(int segments) {
+        QVector<double> xy;
+        xy.reserve(2 * (segments + 1));
+        for (int i = 0; i <= segments; ++i) {
+            double a = i * 0.001;
+            xy << (10.0 + a) * std::cos(a) << (10.0 + a) * std::sin(a);
+        }
+        SketchPolylineSet set;
+        set.append(xy.constData(), segments + 1);
+        return set;
+    }
+
+    // Generous for debug builds; a degenerate tree takes milliseconds
+    const double MaxQueryMicroseconds = 50.0;
+
+    // Two levels per halving, well above what either build produces
+    int heightBound(int segments) {
+        return 2 * int(std::ceil(std::log2(double(segments))));
+    }
+
+    double averageQueryMicroseconds(const SnapEngine& engine, const SketchPolylineSet& set) {
+        const int queries = 10000;
+        const double* xy = set.coords.constData();
+        int points = set.pointCount();
+
+        QElapsedTimer timer;
+        timer.start();
+        int found = 0;
+        for (int q = 0; q < queries; ++q) {
+            int i = int((qint64(q) * 7919) % points);
+            SnapEngine::Snap snap = engine.query(xy[2 * i] + 0.01, xy[2 * i + 1], 0.05, SnapEngine::AllSnaps);
+            if (snap.type != SnapEngine::None) ++found;
+        }
+        double microseconds = timer.nsecsElapsed() / 1.0e3 / queries;
+        // Every query is next to the curve
+        if (found != queries) return -1.0;
+        return microseconds;
+    }
+}
+
+class SnapEngineTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void bulkHeight();
+    void appendedHeight();
+    void singleSegments();
+    void endpointsMatchBruteForce();
+    void snapsAreExact();
+};
+
+void SnapEngineTest::bulkHeight() {
+    SketchPolylineSet set = spiral(SegmentCount);
+    SnapEngine engine;
+    engine.setPolylines(set);
+    QCOMPARE(engine.segmentCount(), SegmentCount);
+    QVERIFY2(engine.treeHeight() <= heightBound(SegmentCount),
+             qPrintable(QString("height %1").arg(engine.treeHeight())));
+
+    double microseconds = averageQueryMicroseconds(engine, set);
+    QVERIFY(microseconds >= 0.0);
+    QVERIFY2(microseconds < MaxQueryMicroseconds, qPrintable(QString("%1 us per query").arg(microseconds)));
+}
+
+void SnapEngineTest::appendedHeight() {
+    SketchPolylineSet set = spiral(SegmentCount);
+    SnapEngine engine;
+    engine.appendPolyline(set.coords.constData(), set.pointCount());
+    QCOMPARE(engine.segmentCount(), SegmentCount);
+    QVERIFY2(engine.treeHeight() <= heightBound(SegmentCount),
+             qPrintable(QString("height %1").arg(engine.treeHeight())));
+
+    double microseconds = averageQueryMicroseconds(engine, set);
+    QVERIFY(microseconds >= 0.0);
+    QVERIFY2(microseconds < MaxQueryMicroseconds, qPrintable(QString("%1 us per query").arg(microseconds)));
+}
+
+void SnapEngineTest::singleSegments() {
+    // One polyline per segment, as drawing them one at a time does
+    SketchPolylineSet set = spiral(SegmentCount);
+    SnapEngine engine;
+    for (int i = 0; i < SegmentCount; ++i) engine.appendPolyline(set.coords.constData() + 2 * i, 2);
+    QCOMPARE(engine.polylineCount(), SegmentCount);
+    QVERIFY2(engine.treeHeight() <= heightBound(SegmentCount),
+             qPrintable(QString("height %1").arg(engine.treeHeight())));
+}
+
+void SnapEngineTest::endpointsMatchBruteForce() {
+    // Scattered segments, half bulk-built and half appended
+    QVector<double> xy;
+    quint32 seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / double(1 << 24);
+    };
+    for (int i = 0; i < 4000; ++i) {
+        double u = next() * 100.0, v = next() * 100.0;
+        xy << u << v << u + next() * 4.0 - 2.0 << v + next() * 4.0 - 2.0;
+    }
+
+    SketchPolylineSet first;
+    for (int i = 0; i < 2000; ++i) first.append(xy.constData() + 4 * i, 2);
+    SnapEngine engine;
+    engine.setPolylines(first);
+    for (int i = 2000; i < 4000; ++i) engine.appendPolyline(xy.constData() + 4 * i, 2);
+
+    const double radius = 1.5;
+    for (int q = 0; q < 500; ++q) {
+        double u = next() * 100.0, v = next() * 100.0;
+        double best = radius;
+        bool any = false;
+        for (int i = 0; i < xy.size(); i += 2) {
+            double d = std::hypot(xy[i] - u, xy[i + 1] - v);
+            if (d <= best) {
+                best = d;
+                any = true;
+            }
+        }
+
+        SnapEngine::Snap snap = engine.query(u, v, radius, SnapEngine::Endpoint);
+        QCOMPARE(snap.type != SnapEngine::None, any);
+        if (any) QVERIFY(qFuzzyCompare(1.0 + std::hypot(snap.u - u, snap.v - v), 1.0 + best));
+    }
+}
+
+void SnapEngineTest::snapsAreExact() {
+    // Values that do not survive a round trip through float
+    const double xy[] = { 1.08664, 2.71828, 3.14159, 0.57721, 1.08664, 4.66920 };
+    SnapEngine engine;
+    engine.appendPolyline(xy, 3);
+
+    SnapEngine::Snap snap = engine.query(3.1, 0.6, 0.5, SnapEngine::Endpoint);
+    QCOMPARE(snap.type, SnapEngine::Endpoint);
+    QVERIFY(snap.u == 3.14159 && snap.v == 0.57721);
+}
+
+QTEST_GUILESS_MAIN(SnapEngineTest)
+
+#include "tst_snapengine.moc"
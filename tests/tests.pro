@@ -0,0 +1,9 @@
+# tests.pro - unit tests, one QtTest executable per subdirectory.
+# Run them with "make check" after building.
+
+TEMPLATE = subdirs
+
+SUBDIRS = \
+    geometry \
+    snap \
+    document